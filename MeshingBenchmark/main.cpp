@@ -0,0 +1,299 @@
+/**
+
+    Standalone CPU benchmark of the terrain generation and greedy mesher. Needs neither Vulkan nor GLFW.
+
+    Every scenario is generated from a fixed seed so runs are comparable between mesher and storage changes.
+
+    Usage: MeshingBenchmark [--threads N] [--chunks N] [--scenario name] [--no-arena]
+
+    Every thread meshes with its own MeshingArena like the chunk loading threads do, --no-arena allocates
+    fresh scratch and output for every chunk instead.
+
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "GreedyMesh.hpp"
+#include "ChunkVoxels.hpp"
+#include "DemoConsts.hpp"
+#include "PerlinNoise.hpp"
+
+namespace
+{
+    std::atomic<uint64_t> allocatedBytes = 0;
+    std::atomic<uint64_t> allocationCount = 0;
+}
+
+// Count every allocation so the bytes allocated while meshing can be reported.
+void* operator new(std::size_t size)
+{
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+namespace
+{
+    constexpr int VOXELS_PER_CHUNK = CHUNK_VOXEL_COUNT * CHUNK_VOXEL_COUNT * CHUNK_VOXEL_COUNT;
+    constexpr uint32_t SCENARIO_SEED = 1337u;
+
+    /**
+        The voxels of one chunk to mesh. Uniform chunks are not allocated, the same as Chunk does.
+    */
+    struct BenchmarkChunk {
+        int*** Voxels = nullptr;
+        int SolidVoxelCount = 0;
+    };
+
+    struct Scenario {
+        std::string Name;
+        // Fill the voxels of the given chunk index.
+        std::function<BenchmarkChunk(int)> Generate;
+    };
+
+    /**
+        Allocate and fill a chunk from a per voxel function. O(n^3)
+    */
+    BenchmarkChunk FillChunk(const std::function<bool(int, int, int)>& solid)
+    {
+        BenchmarkChunk chunk;
+        chunk.Voxels = AllocateVoxels(CHUNK_VOXEL_COUNT);
+        for (int x = 0; x < CHUNK_VOXEL_COUNT; x++) {
+            for (int y = 0; y < CHUNK_VOXEL_COUNT; y++) {
+                for (int z = 0; z < CHUNK_VOXEL_COUNT; z++) {
+                    chunk.Voxels[x][y][z] = solid(x, y, z) ? 1 : 0;
+                    chunk.SolidVoxelCount += chunk.Voxels[x][y][z];
+                }
+            }
+        }
+        return chunk;
+    }
+
+    /**
+        Lay the chunks out on a square grid, so chunk i of the hills and caves samples a different part of the world.
+    */
+    glm::vec3 ChunkLocation(int index, float y)
+    {
+        return glm::vec3((index % 16) * CHUNK_VOXEL_COUNT, y, (index / 16) * CHUNK_VOXEL_COUNT);
+    }
+
+    std::vector<Scenario> CreateScenarios()
+    {
+        std::vector<Scenario> scenarios;
+        scenarios.push_back({ "empty", [](int) {
+            return FillChunk([](int, int, int) { return false; });
+        } });
+        scenarios.push_back({ "full", [](int) {
+            BenchmarkChunk chunk;
+            chunk.SolidVoxelCount = VOXELS_PER_CHUNK;
+            return chunk;
+        } });
+        scenarios.push_back({ "flat", [](int) {
+            return FillChunk([](int, int y, int) { return y < CHUNK_VOXEL_COUNT / 2; });
+        } });
+        scenarios.push_back({ "hills", [](int index) {
+            // Sit the chunks at the average terrain height so most of them cross the surface.
+            TerrainVoxels terrain = GenerateTerrainVoxels(ChunkLocation(index, CHUNK_VOXEL_COUNT));
+            BenchmarkChunk chunk;
+            chunk.Voxels = terrain.Voxels;
+            chunk.SolidVoxelCount = terrain.SolidVoxelCount;
+            return chunk;
+        } });
+        scenarios.push_back({ "checkerboard", [](int) {
+            // Worst case, no two faces can be merged.
+            return FillChunk([](int x, int y, int z) { return (x + y + z) % 2 == 0; });
+        } });
+        scenarios.push_back({ "random50", [](int index) {
+            std::mt19937 random(SCENARIO_SEED + index);
+            std::bernoulli_distribution solid(0.5);
+            return FillChunk([&](int, int, int) { return solid(random); });
+        } });
+        scenarios.push_back({ "caves", [](int index) {
+            static const siv::PerlinNoise caveNoise{ SCENARIO_SEED };
+            glm::vec3 location = ChunkLocation(index, 0);
+            return FillChunk([&](int x, int y, int z) {
+                return caveNoise.noise3D((location.x + x) * 0.08, (location.y + y) * 0.08, (location.z + z) * 0.08) > -0.1;
+            });
+        } });
+        return scenarios;
+    }
+
+    struct MeshResult {
+        double Seconds = 0;
+        uint64_t Quads = 0;
+        uint64_t OutputBytes = 0;
+        uint64_t AllocatedBytes = 0;
+        uint64_t Allocations = 0;
+    };
+
+    /**
+        Mesh every chunk meshCount times in total, split across the given number of threads.
+    */
+    MeshResult MeshChunks(const std::vector<BenchmarkChunk>& chunks, int meshCount, int threadCount, bool useArena)
+    {
+        std::atomic<uint64_t> quads = 0;
+        std::atomic<uint64_t> outputBytes = 0;
+        std::atomic<int> nextMesh = 0;
+
+        uint64_t allocatedBefore = allocatedBytes.load();
+        uint64_t allocationsBefore = allocationCount.load();
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++)
+        {
+            threads.emplace_back([&]() {
+                uint64_t threadQuads = 0;
+                uint64_t threadBytes = 0;
+                MeshingArena arena;
+                for (int i = nextMesh++; i < meshCount; i = nextMesh++)
+                {
+                    const BenchmarkChunk& chunk = chunks[i % chunks.size()];
+                    AlgorithmOutput freshOutput;
+                    if (useArena)
+                    {
+                        arena.Reset();
+                        greedyMeshAlgorithm(arena.Output, chunk.Voxels, CHUNK_VOXEL_COUNT, chunk.SolidVoxelCount, nullptr, &arena.Scratch);
+                    }
+                    else
+                    {
+                        freshOutput = greedyMeshAlgorithm(chunk.Voxels, CHUNK_VOXEL_COUNT, chunk.SolidVoxelCount);
+                    }
+                    const AlgorithmOutput& output = useArena ? arena.Output : freshOutput;
+                    threadQuads += output.indicies.size() / 6;
+                    threadBytes += output.verticies.size() * sizeof(Vertex) + output.indicies.size() * sizeof(uint32_t);
+                }
+                quads += threadQuads;
+                outputBytes += threadBytes;
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        MeshResult result;
+        result.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.Quads = quads;
+        result.OutputBytes = outputBytes;
+        // Includes the few allocations made to start the threads, and with arenas the ones that grow them to the biggest chunk.
+        result.AllocatedBytes = allocatedBytes.load() - allocatedBefore;
+        result.Allocations = allocationCount.load() - allocationsBefore;
+        return result;
+    }
+
+    int ReadIntArgument(int argc, char** argv, int& i)
+    {
+        if (i + 1 >= argc)
+        {
+            std::cerr << "Missing value for " << argv[i] << std::endl;
+            std::exit(1);
+        }
+        return std::max(1, std::atoi(argv[++i]));
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    // The distinct chunks generated per scenario, and how many meshes are made from them per thread count.
+    int distinctChunks = 64;
+    int meshCount = 2048;
+    std::string onlyScenario;
+    bool useArena = true;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--threads") maxThreads = ReadIntArgument(argc, argv, i);
+        else if (argument == "--chunks") meshCount = ReadIntArgument(argc, argv, i);
+        else if (argument == "--scenario" && i + 1 < argc) onlyScenario = argv[++i];
+        else if (argument == "--no-arena") useArena = false;
+        else
+        {
+            std::cerr << "Usage: MeshingBenchmark [--threads N] [--chunks N] [--scenario name] [--no-arena]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Chunk size " << CHUNK_VOXEL_COUNT << "^3, " << meshCount << " meshes per run, 1.." << maxThreads << " threads, "
+        << (useArena ? "per thread arenas" : "no arenas") << std::endl;
+    std::cout << std::left << std::setw(14) << "scenario" << std::right
+        << std::setw(8) << "threads"
+        << std::setw(12) << "chunks/s"
+        << std::setw(11) << "ns/voxel"
+        << std::setw(13) << "quads/chunk"
+        << std::setw(14) << "output B/ch"
+        << std::setw(14) << "alloc B/ch"
+        << std::setw(12) << "allocs/ch"
+        << std::setw(10) << "speedup" << std::endl;
+    std::cout << std::fixed;
+
+    for (auto& scenario : CreateScenarios())
+    {
+        if (!onlyScenario.empty() && scenario.Name != onlyScenario) continue;
+
+        std::vector<BenchmarkChunk> chunks;
+        auto generateStart = std::chrono::steady_clock::now();
+        for (int i = 0; i < distinctChunks; i++)
+        {
+            chunks.push_back(scenario.Generate(i));
+        }
+        double generateSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - generateStart).count();
+
+        // Warm up the caches and the allocator.
+        MeshChunks(chunks, distinctChunks, 1, useArena);
+
+        double singleThreadRate = 0;
+        for (int threads = 1; threads <= maxThreads; threads *= 2)
+        {
+            MeshResult result = MeshChunks(chunks, meshCount, threads, useArena);
+            double chunksPerSecond = meshCount / result.Seconds;
+            if (threads == 1) singleThreadRate = chunksPerSecond;
+            // Thread time per voxel, so it only stays flat as threads are added if meshing scales perfectly.
+            double nsPerVoxel = result.Seconds * 1e9 * threads / ((double)meshCount * VOXELS_PER_CHUNK);
+
+            std::cout << std::left << std::setw(14) << scenario.Name << std::right
+                << std::setw(8) << threads
+                << std::setw(12) << std::setprecision(0) << chunksPerSecond
+                << std::setw(11) << std::setprecision(2) << nsPerVoxel
+                << std::setw(13) << std::setprecision(1) << (double)result.Quads / meshCount
+                << std::setw(14) << std::setprecision(0) << (double)result.OutputBytes / meshCount
+                << std::setw(14) << (double)result.AllocatedBytes / meshCount
+                << std::setw(12) << std::setprecision(1) << (double)result.Allocations / meshCount
+                << std::setw(9) << std::setprecision(2) << chunksPerSecond / singleThreadRate << "x" << std::endl;
+
+            // Always finish with the requested thread count, even if it is not a power of two.
+            if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
+        }
+        std::cout << std::left << std::setw(14) << scenario.Name << std::right
+            << " generation " << std::setprecision(2) << generateSeconds * 1e9 / ((double)distinctChunks * VOXELS_PER_CHUNK) << " ns/voxel" << std::endl;
+
+        for (auto& chunk : chunks)
+        {
+            if (chunk.Voxels != nullptr) FreeVoxels(chunk.Voxels, CHUNK_VOXEL_COUNT);
+        }
+    }
+
+    return 0;
+}
@@ -3,10 +3,10 @@
 #ifndef DArray_H
 #define DArray_H
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
 #include <string.h>
 
+#include "GlmIncludes.hpp"
+
 /**
 
 	A psuedo 3D array that only uses a single array for speed.
@@ -17,11 +17,16 @@ class ThreeDArray {
 private:
 	T* arr;
 	size_t size;
+	bool owned;
 
 public:
 	ThreeDArray(size_t size);
+	ThreeDArray(size_t size, T* storage);
 	~ThreeDArray();
 
+	ThreeDArray(const ThreeDArray&) = delete;
+	ThreeDArray& operator=(const ThreeDArray&) = delete;
+
 	void zeroOut();
 	T at(size_t x, size_t y, size_t z);
 	T at(glm::vec3 vec);
@@ -35,11 +40,24 @@ template <class T>
 ThreeDArray<T>::ThreeDArray(size_t size) {
 	this->size = size;
 	this->arr = new T[this->size * this->size * this->size];
+	this->owned = true;
+}
+
+/**
+
+	Use memory of size^3 values that outlives the array, such as scratch memory, instead of allocating it.
+
+*/
+template <class T>
+ThreeDArray<T>::ThreeDArray(size_t size, T* storage) {
+	this->size = size;
+	this->arr = storage;
+	this->owned = false;
 }
 
 template <class T>
 ThreeDArray<T>::~ThreeDArray() {
-	delete[] this->arr;
+	if (this->owned) delete[] this->arr;
 	this->arr = 0;
 	this->size = 0;
 }
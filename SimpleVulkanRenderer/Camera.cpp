@@ -16,6 +16,11 @@ glm::mat4 Camera::GetViewMatrix()
 	return glm::lookAt(mPos, mPos + mFront, mUp);
 }
 
+glm::vec3 Camera::Position()
+{
+	return mPos;
+}
+
 void Camera::MoveForward(float speed)
 {
 	mPos += speed * mFront;
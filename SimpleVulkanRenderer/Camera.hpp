@@ -11,6 +11,7 @@ public:
 	void SetupCamera(GLFWwindow* window);
 
 	glm::mat4 GetViewMatrix();
+	glm::vec3 Position();
 	void MoveForward(float speed);
 	void MoveBackward(float speed);
 	void MoveLeft(float speed);
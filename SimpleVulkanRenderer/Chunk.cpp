@@ -1,79 +1,521 @@
 #include "Chunk.hpp"
 #include "GreedyMesh.hpp"
 #include "DemoConsts.hpp"
+#include "CpuProfiler.hpp"
+#include "ChunkVoxels.hpp"
+#include "VulkanMemoryStats.hpp"
+#include "VulkanStagingMeshSink.hpp"
 
-#include "PerlinNoise.hpp"
+#include <algorithm>
 
-const siv::PerlinNoise perlin{ 123456u };
+namespace
+{
+    /**
+        Scales the quads of a mesh made from downsampled cells back to chunk coordinates on their way to another sink.
+    */
+    class ScaledMeshSink : public MeshSink
+    {
+    public:
+        ScaledMeshSink(MeshSink& output, int factor)
+            :
+            mOutput(output),
+            mFactor((float)factor)
+        {
+        }
+
+        void AddQuad(const Vertex* vertices, const uint32_t* indices) override
+        {
+            // Cell i spans [i - 0.5, i + 0.5], it has to cover voxels i * factor to i * factor + factor - 1.
+            Vertex scaled[4];
+            for (int i = 0; i < 4; i++)
+            {
+                scaled[i] = vertices[i];
+                scaled[i].pos = (vertices[i].pos + glm::vec3(0.5f, 0.5f, 0.5f)) * mFactor - glm::vec3(0.5f, 0.5f, 0.5f);
+            }
+            mOutput.AddQuad(scaled, indices);
+        }
 
+    private:
+        MeshSink& mOutput;
+        float mFactor;
+    };
+
+    std::atomic<uint64_t> nextMeshId = 1;
+
+    /**
+        Compress a mesh to retain on the CPU, counted by VulkanMemoryStats for as long as it lives. O(n)
+
+        @return Null if the mesh can't be compressed.
+    */
+    std::shared_ptr<const CompressedMesh> RetainCompressed(const AlgorithmOutput& output)
+    {
+        CompressedMesh compressed;
+        if (!CompressMesh(output.verticies, output.indicies, compressed)) return nullptr;
+
+        size_t bytes = compressed.Bytes();
+        VulkanMemoryStats::Allocate(CPU_MESH_MEMORY, bytes);
+        return std::shared_ptr<const CompressedMesh>(new CompressedMesh(std::move(compressed)), [bytes](const CompressedMesh* mesh) {
+            VulkanMemoryStats::Free(CPU_MESH_MEMORY, bytes);
+            delete mesh;
+        });
+    }
+}
+
+ChunkMeshingWorkspace::ChunkMeshingWorkspace(Ptr(VulkanBufferUtilities) bufferUtils)
+    :
+    mStaging(bufferUtils),
+    mCountedBytes(0)
+{
+}
+
+ChunkMeshingWorkspace::~ChunkMeshingWorkspace()
+{
+    VulkanMemoryStats::Free(CPU_MESH_MEMORY, mCountedBytes);
+}
+
+void ChunkMeshingWorkspace::UpdateMemoryStats()
+{
+    // The staging buffer counts itself as staging memory, its spilled quads are on the CPU.
+    size_t bytes = mArena.Bytes() + mStaging.SpillBytes();
+    if (bytes > mCountedBytes) VulkanMemoryStats::Allocate(CPU_MESH_MEMORY, bytes - mCountedBytes);
+    else VulkanMemoryStats::Free(CPU_MESH_MEMORY, mCountedBytes - bytes);
+    mCountedBytes = bytes;
+}
 
 Chunk::Chunk()
     :
     mFinishedGenerating(false),
-    mLocation({0, 0, 0})
+    mLocation({0, 0, 0}),
+    mSolidVoxelCount(0),
+    mBuried(false),
+    mVoxels(nullptr),
+    mVoxelsGenerated(false),
+    mNeighbours{},
+    mDirty(false),
+    mLod(0),
+    mTransformVersion(0),
+    mWrittenTransformVersion(0),
+    mWrittenRootVersion(0),
+    mEvicted(false),
+    mEvictedMemory(0),
+    mContentVersion(0),
+    mEvictedContentVersion(0)
 {
 }
 
 Chunk::Chunk(glm::vec3 location)
 	:
 	mFinishedGenerating(false),
-    mLocation(location)
+    mLocation(location),
+    mSolidVoxelCount(0),
+    mBuried(false),
+    mVoxels(nullptr),
+    mVoxelsGenerated(false),
+    mNeighbours{},
+    mDirty(false),
+    mLod(0),
+    mTransformVersion(0),
+    mWrittenTransformVersion(0),
+    mWrittenRootVersion(0),
+    mEvicted(false),
+    mEvictedMemory(0),
+    mContentVersion(0),
+    mEvictedContentVersion(0)
+{
+}
+
+Chunk::~Chunk()
+{
+    if (mVoxels == nullptr) return;
+
+    FreeVoxels(mVoxels, CHUNK_VOXEL_COUNT);
+    VulkanMemoryStats::Free(CPU_VOXEL_MEMORY, VoxelBytes(CHUNK_VOXEL_COUNT));
+}
+
+
+
+void Chunk::GenerateChunk(Ptr(VulkanBufferUtilities) bufferUtils, Ptr(VulkanDeletionQueue) deletionQueue, Ptr(VulkanCommandPool) commandPool, VulkanQueue queue, ChunkMeshingWorkspace& workspace)
 {
+    GenerateVoxels();
+    GenerateMesh(bufferUtils, deletionQueue, commandPool, queue, workspace);
+}
+
+void Chunk::GenerateVoxels()
+{
+    CPU_PROFILE_ZONE("NoiseFill");
+    TerrainVoxels terrain = GenerateTerrainVoxels(mLocation);
+    mVoxels = terrain.Voxels;
+    if (mVoxels != nullptr)
+    {
+        VulkanMemoryStats::Allocate(CPU_VOXEL_MEMORY, VoxelBytes(CHUNK_VOXEL_COUNT));
+    }
+    mSolidVoxelCount = terrain.SolidVoxelCount;
+    mBuried = terrain.Buried;
+    mVoxelsGenerated = true;
 }
 
-void Chunk::GenerateChunk(Ptr(VulkanBufferUtilities) bufferUtils, Ptr(VulkanCommandPool) commandPool, VulkanQueue queue)
+void Chunk::GenerateMesh(Ptr(VulkanBufferUtilities) bufferUtils, Ptr(VulkanDeletionQueue) deletionQueue, Ptr(VulkanCommandPool) commandPool, VulkanQueue queue, ChunkMeshingWorkspace& workspace)
 {
-    int*** chunkArray = new int** [CHUNK_VOXEL_COUNT];
-    for (int x = 0; x < CHUNK_VOXEL_COUNT; x++) {
-        chunkArray[x] = new int* [CHUNK_VOXEL_COUNT];
-        for (int y = 0; y < CHUNK_VOXEL_COUNT; y++) {
-            chunkArray[x][y] = new int[CHUNK_VOXEL_COUNT];
-            for (int z = 0; z < CHUNK_VOXEL_COUNT; z++) {
-                double noise = perlin.octave2D_01(((mLocation.x + x) * 0.01), ((mLocation.z + z) * 0.01), 4);
-                noise *= 2 * CHUNK_VOXEL_COUNT;
-                if(mLocation.y + y > noise)
-                    chunkArray[x][y][z] = /*rand() % 2*/ 0;
+    // Every change made up to this point is part of this mesh.
+    mDirty = false;
+    uint64_t contentVersion = mContentVersion;
+    int lod = mLod;
+    // After reading the version, edits staged from here on make the chunk dirty again.
+    ApplyPendingEdits();
+
+    // A restored chunk that did not change since its eviction is uploaded from the compressed copy.
+    std::shared_ptr<const CompressedMesh> retainedMesh;
+    {
+        std::lock_guard<std::mutex> lock(mEvictionMutex);
+        if (mEvictedMesh != nullptr && mEvictedContentVersion == contentVersion)
+        {
+            retainedMesh = mEvictedMesh;
+        }
+        mEvictedMesh = nullptr;
+    }
+
+    // Meshed straight into staging memory, unless the mesh has to stay on the CPU to be compressed.
+    // A decompressed mesh is already on the CPU and is uploaded from there.
+    bool stageDirectly = retainedMesh == nullptr && !CHUNK_RETAIN_COMPRESSED_MESHES;
+    // Reused from the last chunk this thread meshed.
+    MeshingArena& arena = workspace.Arena();
+    arena.Reset();
+    AlgorithmOutput& output = arena.Output;
+    VulkanStagingMeshSink& staging = workspace.Staging();
+    MeshSink& sink = stageDirectly ? static_cast<MeshSink&>(staging) : output;
+    if (retainedMesh != nullptr)
+    {
+        CPU_PROFILE_ZONE("Decompress");
+        DecompressMesh(*retainedMesh, output.verticies, output.indicies);
+    }
+    else
+    {
+        CPU_PROFILE_ZONE("Meshing");
+        // Hold the voxels of this chunk and its neighbours steady while meshing.
+        std::vector<std::shared_lock<std::shared_mutex>> voxelLocks;
+        voxelLocks.emplace_back(mVoxelMutex);
+
+        int factor = 1 << lod;
+        int cellCount = CHUNK_VOXEL_COUNT / factor;
+
+        // Only cull against neighbours at the same level of detail. Otherwise the border faces are kept,
+        // they act as skirts that cover the cracks between different levels of detail.
+        ChunkNeighbours neighbours;
+        for (int face = 0; face < CHUNK_FACE_COUNT; face++)
+        {
+            Chunk* neighbour = mNeighbours[face];
+            if (neighbour == nullptr || neighbour->Lod() != lod) continue;
+
+            voxelLocks.emplace_back(neighbour->mVoxelMutex);
+            neighbours[face] = neighbour->NeighbourView();
+            if (lod != 0 && neighbours[face].Voxels != nullptr)
+            {
+                // Only the neighbour's layer of cells bordering this chunk is read.
+                neighbours[face].Voxels = DownsampleFace(neighbours[face].Voxels, factor, OppositeFace(static_cast<ChunkFace>(face)), arena.Scratch);
+            }
+        }
+
+        // Stays in force at every level of detail until an edit reaches the chunk or a neighbour's shared border.
+        bool meshed = mSolidVoxelCount != 0 && !mBuried;
+        if (stageDirectly)
+        {
+            // A remesh usually emits about as many quads as the last mesh did.
+            size_t estimate = 0;
+            if (meshed)
+            {
+                int solidCellCount = lod == 0 ? mSolidVoxelCount : -1;
+                auto previousMesh = Mesh();
+                estimate = previousMesh != nullptr && previousMesh->IndexCount != 0
+                    ? previousMesh->IndexCount / 6 + previousMesh->IndexCount / 24
+                    : estimateMeshQuads(cellCount, solidCellCount);
+                estimate = std::min(estimate, maxMeshQuads(cellCount, solidCellCount));
+            }
+            staging.Begin(estimate);
+        }
+
+        if (meshed)
+        {
+            if (lod == 0)
+            {
+                greedyMeshAlgorithm(sink, mVoxels, CHUNK_VOXEL_COUNT, mSolidVoxelCount, &neighbours, &arena.Scratch);
+            }
+            else
+            {
+                ScaledMeshSink scaledSink(sink, factor);
+                if (mVoxels == nullptr)
+                {
+                    // A uniform chunk is just as full at every level of detail.
+                    greedyMeshAlgorithm(scaledSink, nullptr, cellCount, cellCount * cellCount * cellCount, &neighbours, &arena.Scratch);
+                }
                 else
-                    chunkArray[x][y][z] = /*rand() % 2*/ 1;
+                {
+                    int solidCellCount;
+                    int*** cells = DownsampleVoxels(mVoxels, factor, solidCellCount, &arena.Scratch);
+                    greedyMeshAlgorithm(scaledSink, cells, cellCount, solidCellCount, &neighbours, &arena.Scratch);
+                }
             }
         }
     }
 
-    AlgorithmOutput output = greedyMeshAlgorithm(chunkArray, CHUNK_VOXEL_COUNT, -1);
+    workspace.UpdateMemoryStats();
+
+    auto mesh = std::make_shared<ChunkMesh>();
+    mesh->Id = nextMeshId++;
+    mesh->ContentVersion = contentVersion;
+    mesh->IndexCount = stageDirectly ? staging.IndexCount() : static_cast<uint32_t>(output.indicies.size());
+
+    if (mesh->IndexCount != 0)
+    {
+        if (CHUNK_RETAIN_COMPRESSED_MESHES)
+        {
+            mesh->Compressed = retainedMesh != nullptr ? retainedMesh : RetainCompressed(output);
+            mesh->CpuBytes = mesh->Compressed != nullptr ? mesh->Compressed->Bytes() : 0;
+        }
 
-    mVertices.reserve(mVertices.size() + output.verticies.size());
-    mVertices.insert(mVertices.end(), output.verticies.begin(), output.verticies.end());
+        CPU_PROFILE_ZONE("Upload");
+        if (stageDirectly)
+        {
+            // Already in staging memory, only the copy to the device local buffers is left.
+            staging.Upload(mesh->VertexBuffer, mesh->IndexBuffer, commandPool, queue.queue);
+            mesh->GpuBytes = staging.MeshBytes();
+        }
+        else
+        {
+            // Vertex Buffer
+            mesh->VertexBuffer = bufferUtils->CreateVertexBuffer(output.verticies, commandPool, queue.queue);
 
-    mIndices.reserve(mIndices.size() + output.indicies.size());
-    mIndices.insert(mIndices.end(), output.indicies.begin(), output.indicies.end());
+            // Index Buffer
+            bufferUtils->CreateIndexBuffer(output.indicies, mesh->IndexBuffer, mesh->IndexBuffer, commandPool, queue.queue);
+            mesh->GpuBytes = output.verticies.size() * sizeof(Vertex) + output.indicies.size() * sizeof(uint32_t);
+        }
 
-    if (mIndices.empty())
+        // Model Buffer, not needed when the chunk origin is a push constant.
+        if (!CHUNK_PUSH_CONSTANT_TRANSFORMS && !mModelBuffer.Initialized())
+        {
+            bufferUtils->CreateBuffer(sizeof(glm::mat4), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mModelBuffer, mModelBuffer);
+            bufferUtils->MapMemory(mModelBuffer, 0, sizeof(glm::mat4), 0, mModelBuffer.DirectMappedMemory());
+            // Publishes the buffer to the render thread, which writes the matrix into it.
+            mTransformVersion++;
+        }
+    }
+
+    // Publish the new mesh, the render thread picks it up the next time it loads the mesh.
+    // If the chunk was evicted while meshing, the budget still applies, so the new mesh is dropped instead.
+    std::shared_ptr<ChunkMesh> retiredMesh;
+    {
+        std::lock_guard<std::mutex> lock(mEvictionMutex);
+        if (mEvicted)
+        {
+            retiredMesh = mesh;
+            mEvictedMemory = mesh->GpuBytes;
+            mEvictedMesh = mesh->Compressed;
+            mEvictedContentVersion = mesh->ContentVersion;
+        }
+        else
+        {
+            retiredMesh = std::atomic_exchange(&mMesh, mesh);
+        }
+    }
+    if (retiredMesh != nullptr)
     {
-        mFinishedGenerating = true;
-        return;
+        deletionQueue->RetireBuffer(retiredMesh->VertexBuffer);
+        deletionQueue->RetireBuffer(retiredMesh->IndexBuffer);
     }
 
-    // Vertex Buffer
-    mVertexBuffer = bufferUtils->CreateVertexBuffer(mVertices, commandPool->CommandPool(), queue.queue);
+    mFinishedGenerating = true;
+}
+
+void Chunk::SetVoxel(int x, int y, int z, int value)
+{
+    SetVoxels({ { x, y, z, value } });
+}
+
+void Chunk::SetVoxels(const std::vector<VoxelEdit>& edits)
+{
+    if (edits.empty()) return;
 
-    // Index Buffer
-    bufferUtils->CreateIndexBuffer(mIndices, mIndexBuffer, mIndexBuffer, commandPool->CommandPool(), queue.queue);
+    {
+        std::lock_guard<std::mutex> lock(mPendingEditsMutex);
+        mPendingEdits.insert(mPendingEdits.end(), edits.begin(), edits.end());
+    }
+    MarkDirty();
+}
 
-    // Model Buffer
-    bufferUtils->CreateBuffer(sizeof(glm::mat4), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mModelBuffer, mModelBuffer);
-    bufferUtils->MapMemory(mModelBuffer, 0, sizeof(glm::mat4), 0, mModelBuffer.DirectMappedMemory());
+void Chunk::ApplyPendingEdits()
+{
+    std::vector<VoxelEdit> edits;
+    {
+        std::lock_guard<std::mutex> lock(mPendingEditsMutex);
+        if (mPendingEdits.empty()) return;
+        edits.swap(mPendingEdits);
+    }
 
-    mFinishedGenerating = true;
+    bool changed = false;
+    std::array<bool, CHUNK_FACE_COUNT> touchedFaces{};
+    {
+        std::unique_lock<std::shared_mutex> lock(mVoxelMutex);
+
+        for (const auto& edit : edits)
+        {
+            int current = mVoxels != nullptr ? mVoxels[edit.X][edit.Y][edit.Z] : (mSolidVoxelCount == 0 ? 0 : 1);
+            if (current == edit.Value) continue;
+
+            // Uniform chunks never allocated their voxels, so fill them in before the first change.
+            if (mVoxels == nullptr)
+            {
+                mVoxels = AllocateVoxels(CHUNK_VOXEL_COUNT);
+                VulkanMemoryStats::Allocate(CPU_VOXEL_MEMORY, VoxelBytes(CHUNK_VOXEL_COUNT));
+                for (int x = 0; x < CHUNK_VOXEL_COUNT; x++) {
+                    for (int y = 0; y < CHUNK_VOXEL_COUNT; y++) {
+                        std::fill(mVoxels[x][y], mVoxels[x][y] + CHUNK_VOXEL_COUNT, current);
+                    }
+                }
+            }
+
+            mVoxels[edit.X][edit.Y][edit.Z] = edit.Value;
+            mSolidVoxelCount += edit.Value == 0 ? -1 : 1;
+            changed = true;
+
+            touchedFaces[LEFT_FACE] |= edit.X == 0;
+            touchedFaces[RIGHT_FACE] |= edit.X == CHUNK_VOXEL_COUNT - 1;
+            touchedFaces[BOTTOM_FACE] |= edit.Y == 0;
+            touchedFaces[TOP_FACE] |= edit.Y == CHUNK_VOXEL_COUNT - 1;
+            touchedFaces[BACK_FACE] |= edit.Z == 0;
+            touchedFaces[FRONT_FACE] |= edit.Z == CHUNK_VOXEL_COUNT - 1;
+        }
+    }
+
+    if (!changed) return;
+
+    // The chunk itself was marked dirty when the edits were staged.
+    mBuried = false;
+    // The neighbours cull their border faces against these voxels, so they need remeshing too,
+    // and a buried neighbour may now be exposed.
+    for (int face = 0; face < CHUNK_FACE_COUNT; face++)
+    {
+        if (touchedFaces[face] && mNeighbours[face] != nullptr)
+        {
+            mNeighbours[face]->mBuried = false;
+            mNeighbours[face]->MarkDirty();
+        }
+    }
+}
+
+void Chunk::MarkDirty()
+{
+    mContentVersion++;
+    mDirty = true;
+}
+
+bool Chunk::ConsumeDirty()
+{
+    return mDirty.exchange(false);
+}
+
+void Chunk::SetLod(int lod)
+{
+    if (mLod.exchange(lod) == lod) return;
+
+    MarkDirty();
+    for (auto neighbour : mNeighbours)
+    {
+        if (neighbour != nullptr)
+        {
+            neighbour->MarkDirty();
+        }
+    }
+}
+
+int Chunk::Lod()
+{
+    return mLod;
+}
+
+std::shared_ptr<ChunkMesh> Chunk::Mesh()
+{
+    return std::atomic_load(&mMesh);
+}
+
+size_t Chunk::EvictMesh(Ptr(VulkanDeletionQueue) deletionQueue)
+{
+    std::shared_ptr<ChunkMesh> previousMesh;
+    {
+        std::lock_guard<std::mutex> lock(mEvictionMutex);
+        previousMesh = std::atomic_exchange(&mMesh, std::shared_ptr<ChunkMesh>());
+        mEvicted = true;
+        if (previousMesh == nullptr) return 0;
+
+        // The compressed copy stays resident, only the buffers are freed.
+        if (previousMesh->Compressed != nullptr)
+        {
+            mEvictedMesh = previousMesh->Compressed;
+            mEvictedContentVersion = previousMesh->ContentVersion;
+        }
+        mEvictedMemory = previousMesh->GpuBytes;
+    }
+
+    size_t memory = previousMesh->GpuBytes;
+    deletionQueue->RetireBuffer(previousMesh->VertexBuffer);
+    deletionQueue->RetireBuffer(previousMesh->IndexBuffer);
+    return memory;
+}
+
+void Chunk::RestoreMesh()
+{
+    // Set the dirty flag directly, MarkDirty() would invalidate the compressed copy.
+    std::lock_guard<std::mutex> lock(mEvictionMutex);
+    if (mEvicted.exchange(false))
+    {
+        mDirty = true;
+    }
 }
 
-VulkanBuffer& Chunk::VertexBuffer()
+bool Chunk::Evicted()
 {
-    return mVertexBuffer;
+    return mEvicted;
 }
 
-VulkanBuffer& Chunk::IndexBuffer()
+size_t Chunk::EvictedMemory()
 {
-    return mIndexBuffer;
+    return mEvictedMemory;
+}
+
+size_t Chunk::MeshMemory()
+{
+    auto mesh = Mesh();
+    return mesh != nullptr ? mesh->CpuBytes + mesh->GpuBytes : 0;
+}
+
+size_t Chunk::MemoryUsage()
+{
+    bool hasVoxels;
+    {
+        // Edits may allocate the voxels of a uniform chunk.
+        std::shared_lock<std::shared_mutex> lock(mVoxelMutex);
+        hasVoxels = mVoxels != nullptr;
+    }
+    size_t evictedMeshBytes;
+    {
+        std::lock_guard<std::mutex> lock(mEvictionMutex);
+        evictedMeshBytes = mEvictedMesh != nullptr ? mEvictedMesh->Bytes() : 0;
+    }
+    return (hasVoxels ? VoxelBytes(CHUNK_VOXEL_COUNT) : 0) + MeshMemory() + evictedMeshBytes;
+}
+
+bool Chunk::UpdateModelMatrix(const glm::mat4& root, uint64_t rootVersion)
+{
+    uint64_t transformVersion = mTransformVersion;
+    if (transformVersion == 0 || (transformVersion == mWrittenTransformVersion && rootVersion == mWrittenRootVersion))
+    {
+        return false;
+    }
+
+    glm::mat4 chunkModelMatrix = glm::translate(root, mLocation);
+    memcpy(mModelBuffer.MappedMemory(), &chunkModelMatrix, sizeof(glm::mat4));
+
+    mWrittenTransformVersion = transformVersion;
+    mWrittenRootVersion = rootVersion;
+    return true;
 }
 
 VulkanMappedBuffer& Chunk::ModelBuffer()
@@ -83,7 +525,13 @@ VulkanMappedBuffer& Chunk::ModelBuffer()
 
 size_t Chunk::IndiciesSize()
 {
-    return mIndices.size();
+    auto mesh = Mesh();
+    return mesh != nullptr ? mesh->IndexCount : 0;
+}
+
+int Chunk::SolidVoxelCount()
+{
+    return mSolidVoxelCount;
 }
 
 glm::vec3 Chunk::Location()
@@ -95,3 +543,35 @@ std::atomic_bool& Chunk::FinishedGenerating()
 {
     return mFinishedGenerating;
 }
+
+std::atomic_bool& Chunk::VoxelsGenerated()
+{
+    return mVoxelsGenerated;
+}
+
+void Chunk::SetNeighbour(ChunkFace face, Chunk* neighbour)
+{
+    mNeighbours[face] = neighbour;
+}
+
+bool Chunk::NeighboursGenerated()
+{
+    for (auto neighbour : mNeighbours)
+    {
+        if (neighbour != nullptr && !neighbour->VoxelsGenerated())
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+ChunkNeighbourView Chunk::NeighbourView()
+{
+    ChunkNeighbourView view;
+    view.Voxels = mVoxels;
+    view.UniformValue = mSolidVoxelCount == 0 ? 0 : 1;
+
+    return view;
+}
@@ -8,33 +8,241 @@
 #include "VulkanDescriptorSetBuilder.hpp"
 #include "VulkanDescriptorLayout.hpp"
 #include "VulkanRenderer.hpp"
+#include "VulkanDeletionQueue.hpp"
+
+#include "ChunkNeighbours.hpp"
+#include "MeshCompression.hpp"
+#include "MeshingArena.hpp"
+#include "VulkanStagingMeshSink.hpp"
 
 #include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+/// <summary>
+/// A single voxel change in chunk local coordinates.
+/// </summary>
+struct VoxelEdit
+{
+	int X;
+	int Y;
+	int Z;
+	int Value;
+};
+
+/// <summary>
+/// The geometry of a chunk and the GPU buffers it was uploaded to.
+/// 
+/// A published mesh is never modified, a remesh publishes a new one instead.
+/// </summary>
+struct ChunkMesh
+{
+	// Unique for every mesh ever created, unlike the address of the mesh which may be reused.
+	uint64_t Id;
+	// The vertices and indices only live on the GPU, they are released once uploaded.
+	VulkanBuffer VertexBuffer;
+	VulkanBuffer IndexBuffer;
+	uint32_t IndexCount = 0;
+	// A compact CPU copy to upload again after an eviction, only kept with CHUNK_RETAIN_COMPRESSED_MESHES.
+	std::shared_ptr<const CompressedMesh> Compressed;
+	// The Chunk::mContentVersion the mesh was made from.
+	uint64_t ContentVersion = 0;
+	// The memory held by the compressed copy and by the buffers.
+	size_t CpuBytes = 0;
+	VkDeviceSize GpuBytes = 0;
+};
+
+/// <summary>
+/// The memory a meshing thread reuses for every chunk it meshes, so meshing hardly ever allocates.
+///
+/// Holds the mesher scratch, the CPU mesh output and a persistently mapped staging buffer, each growing to the
+/// biggest chunk seen so far. Not thread safe, every thread that meshes chunks creates its own and keeps it
+/// for as long as it runs. Its memory is counted as CPU mesh and staging memory.
+/// </summary>
+class ChunkMeshingWorkspace
+{
+public:
+	ChunkMeshingWorkspace(Ptr(VulkanBufferUtilities) bufferUtils);
+	~ChunkMeshingWorkspace();
+
+	ChunkMeshingWorkspace(const ChunkMeshingWorkspace&) = delete;
+	ChunkMeshingWorkspace& operator=(const ChunkMeshingWorkspace&) = delete;
+
+	MeshingArena& Arena()
+	{
+		return mArena;
+	}
+
+	VulkanStagingMeshSink& Staging()
+	{
+		return mStaging;
+	}
+
+	/// <summary>
+	/// Count the CPU memory held now, call after meshing a chunk.
+	/// </summary>
+	void UpdateMemoryStats();
+
+private:
+	MeshingArena mArena;
+	VulkanStagingMeshSink mStaging;
+	size_t mCountedBytes;
+};
 
 class Chunk
 {
 public:
 	Chunk();
 	Chunk(glm::vec3 location);
-	void GenerateChunk(Ptr(VulkanBufferUtilities) bufferUtils, Ptr(VulkanCommandPool) commandPool, VulkanQueue queue);
+	~Chunk();
+
+	/// <summary>
+	/// Generate the voxels and the mesh of the chunk.
+	/// 
+	/// The voxels of all neighbours must already be generated.
+	/// </summary>
+	void GenerateChunk(Ptr(VulkanBufferUtilities) bufferUtils, Ptr(VulkanDeletionQueue) deletionQueue, Ptr(VulkanCommandPool) commandPool, VulkanQueue queue, ChunkMeshingWorkspace& workspace);
+	void GenerateVoxels();
+	/// <summary>
+	/// Mesh the chunk and upload it. Only call once NeighboursGenerated() is true.
+	/// 
+	/// The new mesh is published atomically. The buffers of the mesh it replaces are handed
+	/// to the deletion queue, since frames in flight may still be drawing them.
+	/// </summary>
+	/// <param name="workspace">The workspace of the calling thread.</param>
+	void GenerateMesh(Ptr(VulkanBufferUtilities) bufferUtils, Ptr(VulkanDeletionQueue) deletionQueue, Ptr(VulkanCommandPool) commandPool, VulkanQueue queue, ChunkMeshingWorkspace& workspace);
 
-	VulkanBuffer& VertexBuffer();
-	VulkanBuffer& IndexBuffer();
+	/// <summary>
+	/// Change a single voxel. Only call once VoxelsGenerated() is true.
+	/// </summary>
+	void SetVoxel(int x, int y, int z, int value);
+	/// <summary>
+	/// Stage a batch of voxel changes and mark the chunk dirty. Only call once VoxelsGenerated() is true.
+	/// 
+	/// Never waits for meshing, the edits are applied by the next GenerateMesh() on the meshing thread.
+	/// Any neighbour that borders a changed voxel is marked dirty then.
+	/// </summary>
+	void SetVoxels(const std::vector<VoxelEdit>& edits);
+	void MarkDirty();
+	/// <summary>
+	/// Set the level of detail, 0 being full resolution and each level after halving it.
+	/// 
+	/// Marks the chunk and its neighbours dirty if it changed, since neighbours only cull
+	/// their border faces against each other at the same level of detail.
+	/// </summary>
+	void SetLod(int lod);
+	int Lod();
+	/// <summary>
+	/// Clear the dirty flag, returning if the chunk was dirty.
+	/// </summary>
+	bool ConsumeDirty();
+
+	/// <summary>
+	/// Set the chunk bordering the given face. The neighbour is not owned.
+	/// </summary>
+	void SetNeighbour(ChunkFace face, Chunk* neighbour);
+	bool NeighboursGenerated();
+	/// <summary>
+	/// A read-only view of the voxels, valid once VoxelsGenerated() is true.
+	/// </summary>
+	ChunkNeighbourView NeighbourView();
+
+	/// <summary>
+	/// The latest published mesh, or null if the chunk has not been meshed yet.
+	/// 
+	/// Load it once per frame and draw from that copy, a remesh may publish a new one at any time.
+	/// </summary>
+	std::shared_ptr<ChunkMesh> Mesh();
 	VulkanMappedBuffer& ModelBuffer();
+	/// <summary>
+	/// Write the chunk's model matrix (the root transform translated to the chunk) to the model buffer,
+	/// but only if the root or the chunk's own transform changed since it was last written.
+	/// 
+	/// Only call from the render thread.
+	/// </summary>
+	/// <param name="rootVersion">Changes whenever the root transform changes.</param>
+	/// <returns>If the model buffer was written.</returns>
+	bool UpdateModelMatrix(const glm::mat4& root, uint64_t rootVersion);
+
+	/// <summary>
+	/// Drop the mesh and retire its buffers to free their memory. The chunk is not drawn until RestoreMesh() is called.
+	/// 
+	/// The voxels are kept, edits live in them. A compressed copy of the mesh is kept too if there is one,
+	/// the restored mesh is uploaded from it unless the chunk changed in the meantime.
+	/// </summary>
+	/// <returns>The memory the mesh held.</returns>
+	size_t EvictMesh(Ptr(VulkanDeletionQueue) deletionQueue);
+	/// <summary>
+	/// Undo EvictMesh() by marking the chunk dirty, so it is remeshed like after an edit.
+	///
+	/// A mesh finished while the chunk is evicted is not published, it is thrown away and remade on restore.
+	/// </summary>
+	void RestoreMesh();
+	bool Evicted();
+	/// <summary>
+	/// The memory the mesh held when it was evicted, an estimate of what restoring it costs.
+	/// </summary>
+	size_t EvictedMemory();
+	/// <summary>
+	/// The CPU and GPU memory held by the current mesh.
+	/// </summary>
+	size_t MeshMemory();
+	/// <summary>
+	/// The memory held by the voxels, the current mesh and the compressed copy of an evicted mesh.
+	/// </summary>
+	size_t MemoryUsage();
 
 	size_t IndiciesSize();
+	int SolidVoxelCount();
 	glm::vec3 Location();
 
 	std::atomic_bool& FinishedGenerating();
+	std::atomic_bool& VoxelsGenerated();
+private:
+	/// <summary>
+	/// Apply the edits staged by SetVoxels() to the voxels, marking the neighbours bordering a changed voxel dirty.
+	/// </summary>
+	void ApplyPendingEdits();
+
 private:
 	glm::vec3 mLocation;
+	// The number of solid voxels, known once generation has finished.
+	int mSolidVoxelCount;
+	// If every face of the chunk is covered by the surrounding terrain, a buried chunk is not meshed at all.
+	// Cleared by the first edit that changes the chunk or the border a neighbour shares with it.
+	std::atomic_bool mBuried;
+	// Null if the chunk is uniform.
+	int*** mVoxels;
+	std::atomic_bool mVoxelsGenerated;
+	// Applying edits takes this exclusively, meshing takes it shared for the chunk and its neighbours.
+	std::shared_mutex mVoxelMutex;
+	// Edits staged by SetVoxels(), applied before the next mesh. Only held to add or take the edits.
+	std::mutex mPendingEditsMutex;
+	std::vector<VoxelEdit> mPendingEdits;
+	std::array<Chunk*, CHUNK_FACE_COUNT> mNeighbours;
+	std::atomic_bool mDirty;
+	std::atomic_int mLod;
 
-	std::vector<Vertex> mVertices;
-	VulkanBuffer mVertexBuffer;
-	std::vector<uint32_t> mIndices;
-	VulkanBuffer mIndexBuffer;
+	// Only accessed through std::atomic_load and std::atomic_store.
+	std::shared_ptr<ChunkMesh> mMesh;
+	// Set by EvictMesh(), cleared by RestoreMesh(). Changed together with mMesh under mEvictionMutex,
+	// so a mesh is never published onto an evicted chunk.
+	std::atomic_bool mEvicted;
+	std::atomic<size_t> mEvictedMemory;
+	// Bumped whenever the chunk needs remeshing for a reason other than a restore (edits, neighbour edits, level of detail).
+	std::atomic<uint64_t> mContentVersion;
+	// Guards eviction and publishing meshes, and the compressed copy of the evicted mesh with the content version it was made from.
+	std::mutex mEvictionMutex;
+	std::shared_ptr<const CompressedMesh> mEvictedMesh;
+	uint64_t mEvictedContentVersion;
 
 	VulkanMappedBuffer mModelBuffer;
+	// Bumped whenever the chunk's own transform changes, which includes the model buffer being created.
+	// Zero until the model buffer exists.
+	std::atomic<uint64_t> mTransformVersion;
+	// The versions last written to the model buffer, only used by the render thread.
+	uint64_t mWrittenTransformVersion;
+	uint64_t mWrittenRootVersion;
 	std::atomic_bool mFinishedGenerating;
 };
 
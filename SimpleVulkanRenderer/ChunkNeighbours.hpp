@@ -0,0 +1,47 @@
+#pragma once
+#ifndef CHUNK_NEIGHBOURS_H
+#define CHUNK_NEIGHBOURS_H
+
+#include <array>
+
+/**
+
+    The six faces of a chunk. Used to index the neighbours of a chunk.
+
+*/
+enum ChunkFace
+{
+    LEFT_FACE,   // -X
+    RIGHT_FACE,  // +X
+    BOTTOM_FACE, // -Y
+    TOP_FACE,    // +Y
+    BACK_FACE,   // -Z
+    FRONT_FACE   // +Z
+};
+
+constexpr int CHUNK_FACE_COUNT = 6;
+
+/**
+    The face on the other side of a chunk, the one the neighbour across the given face borders it with. O(1)
+*/
+inline ChunkFace OppositeFace(ChunkFace face)
+{
+    return static_cast<ChunkFace>(face ^ 1);
+}
+
+/**
+
+    A read-only view of the voxels of a neighbouring chunk.
+
+    Voxels points at the voxel array of the neighbour. If it is null the neighbour
+    is uniform (or does not exist) and every voxel has the value UniformValue.
+
+*/
+struct ChunkNeighbourView {
+    int*** Voxels = nullptr;
+    int UniformValue = 0;
+};
+
+typedef std::array<ChunkNeighbourView, CHUNK_FACE_COUNT> ChunkNeighbours;
+
+#endif
@@ -0,0 +1,165 @@
+#include "ChunkVoxels.hpp"
+#include "DemoConsts.hpp"
+#include "MeshingArena.hpp"
+
+#include "PerlinNoise.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    const siv::PerlinNoise perlin{ 123456u };
+
+    /**
+        A cell is solid if at least half of the voxels it covers are solid. O(factor^3)
+    */
+    int DownsampleCell(int*** voxels, int factor, int x, int y, int z)
+    {
+        int solid = 0;
+        for (int dx = 0; dx < factor; dx++)
+            for (int dy = 0; dy < factor; dy++)
+                for (int dz = 0; dz < factor; dz++)
+                    solid += voxels[x * factor + dx][y * factor + dy][z * factor + dz] == 1;
+
+        return solid * 2 >= factor * factor * factor ? 1 : 0;
+    }
+}
+
+int*** AllocateVoxels(int size)
+{
+    int*** voxels = new int** [size];
+    for (int x = 0; x < size; x++) {
+        voxels[x] = new int* [size];
+        for (int y = 0; y < size; y++) {
+            voxels[x][y] = new int[size];
+        }
+    }
+    return voxels;
+}
+
+int*** AllocateVoxels(int size, ScratchArena& scratch)
+{
+    int*** voxels = scratch.Allocate<int**>(size);
+    for (int x = 0; x < size; x++) {
+        voxels[x] = scratch.Allocate<int*>(size);
+        for (int y = 0; y < size; y++) {
+            voxels[x][y] = scratch.Allocate<int>(size);
+        }
+    }
+    return voxels;
+}
+
+size_t VoxelBytes(int size)
+{
+    return size * sizeof(int**) + size * size * sizeof(int*) + size * size * size * sizeof(int);
+}
+
+void FreeVoxels(int*** voxels, int size)
+{
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            delete[] voxels[x][y];
+        }
+        delete[] voxels[x];
+    }
+    delete[] voxels;
+}
+
+int*** DownsampleVoxels(int*** voxels, int factor, int& solidCellCount, ScratchArena* scratch)
+{
+    int size = CHUNK_VOXEL_COUNT / factor;
+    int*** cells = scratch != nullptr ? AllocateVoxels(size, *scratch) : AllocateVoxels(size);
+    solidCellCount = 0;
+    for (int x = 0; x < size; x++) {
+        for (int y = 0; y < size; y++) {
+            for (int z = 0; z < size; z++) {
+                cells[x][y][z] = DownsampleCell(voxels, factor, x, y, z);
+                solidCellCount += cells[x][y][z];
+            }
+        }
+    }
+    return cells;
+}
+
+int*** DownsampleFace(int*** voxels, int factor, ChunkFace face, ScratchArena& scratch)
+{
+    int size = CHUNK_VOXEL_COUNT / factor;
+    int*** cells = AllocateVoxels(size, scratch);
+    // Faces come in pairs along each axis, the first of a pair is at cell 0.
+    int axis = face / 2;
+    int layer = face % 2 == 0 ? 0 : size - 1;
+    for (int a = 0; a < size; a++) {
+        for (int b = 0; b < size; b++) {
+            int x = axis == 0 ? layer : a;
+            int y = axis == 1 ? layer : (axis == 0 ? a : b);
+            int z = axis == 2 ? layer : b;
+            cells[x][y][z] = DownsampleCell(voxels, factor, x, y, z);
+        }
+    }
+    return cells;
+}
+
+double SampleTerrainHeight(double worldX, double worldZ)
+{
+    double noise = perlin.octave2D_01((worldX * 0.01), (worldZ * 0.01), 4);
+    return noise * 2 * CHUNK_VOXEL_COUNT;
+}
+
+TerrainVoxels GenerateTerrainVoxels(glm::vec3 location)
+{
+    TerrainVoxels terrain;
+
+    // The noise only depends on x and z, so sample the height map once per column.
+    // The height map is padded by one voxel so the neighbouring columns are known as well.
+    constexpr int paddedSize = CHUNK_VOXEL_COUNT + 2;
+    double heightMap[paddedSize][paddedSize];
+    double minChunkHeight = std::numeric_limits<double>::max();
+    double maxChunkHeight = std::numeric_limits<double>::lowest();
+    double minPaddedHeight = std::numeric_limits<double>::max();
+    for (int x = 0; x < paddedSize; x++) {
+        for (int z = 0; z < paddedSize; z++) {
+            double height = SampleTerrainHeight(location.x + x - 1, location.z + z - 1);
+            heightMap[x][z] = height;
+            minPaddedHeight = std::min(minPaddedHeight, height);
+            if (x == 0 || z == 0 || x == paddedSize - 1 || z == paddedSize - 1) continue;
+            minChunkHeight = std::min(minChunkHeight, height);
+            maxChunkHeight = std::max(maxChunkHeight, height);
+        }
+    }
+
+    // Edge Case: The entire chunk is above the terrain. Nothing needs to be allocated.
+    if (location.y > maxChunkHeight)
+    {
+        return terrain;
+    }
+
+    // Edge Case: The entire chunk is below the terrain.
+    // A full chunk is described by its solid count alone, so the voxels are never allocated.
+    if (location.y + CHUNK_VOXEL_COUNT - 1 <= minChunkHeight)
+    {
+        terrain.SolidVoxelCount = CHUNK_VOXEL_COUNT * CHUNK_VOXEL_COUNT * CHUNK_VOXEL_COUNT;
+        // If the voxels right above and around the chunk are solid too, every face is hidden.
+        terrain.Buried = location.y + CHUNK_VOXEL_COUNT <= minPaddedHeight;
+        return terrain;
+    }
+
+    int solidVoxelCount = 0;
+    int*** chunkArray = AllocateVoxels(CHUNK_VOXEL_COUNT);
+    for (int x = 0; x < CHUNK_VOXEL_COUNT; x++) {
+        for (int y = 0; y < CHUNK_VOXEL_COUNT; y++) {
+            for (int z = 0; z < CHUNK_VOXEL_COUNT; z++) {
+                if(location.y + y > heightMap[x + 1][z + 1])
+                    chunkArray[x][y][z] = /*rand() % 2*/ 0;
+                else
+                {
+                    chunkArray[x][y][z] = /*rand() % 2*/ 1;
+                    solidVoxelCount++;
+                }
+            }
+        }
+    }
+    terrain.Voxels = chunkArray;
+    terrain.SolidVoxelCount = solidVoxelCount;
+    return terrain;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#ifndef CHUNK_VOXELS_H
+#define CHUNK_VOXELS_H
+
+#include "GlmIncludes.hpp"
+#include "ChunkNeighbours.hpp"
+
+#include <cstddef>
+
+class ScratchArena;
+
+/**
+
+    The voxel storage and terrain generation of a chunk.
+
+    Free of Vulkan so the voxels can be generated and meshed without a renderer (see MeshingBenchmark).
+
+*/
+
+/**
+
+    The voxels of a chunk generated from the terrain.
+
+    Voxels is null when the chunk is uniform, SolidVoxelCount is then either zero or the size of the whole chunk.
+
+*/
+struct TerrainVoxels {
+    int*** Voxels = nullptr;
+    int SolidVoxelCount = 0;
+    // If the chunk is full and so are the voxels right above and around it, every face is hidden.
+    bool Buried = false;
+};
+
+/**
+    Allocate a cube of voxels, the values are left uninitialized. O(n^2)
+*/
+int*** AllocateVoxels(int size);
+
+/**
+    Allocate a cube of voxels from scratch memory, released with the arena instead of FreeVoxels(). O(n^2)
+*/
+int*** AllocateVoxels(int size, ScratchArena& scratch);
+
+/**
+    The bytes allocated by AllocateVoxels() for a cube of the given size. O(1)
+*/
+size_t VoxelBytes(int size);
+
+/**
+    Free voxels allocated with AllocateVoxels(). O(n^2)
+*/
+void FreeVoxels(int*** voxels, int size);
+
+/**
+    Downsample the voxels of a chunk by the given factor. O(n^3)
+
+    A cell is solid if at least half of the voxels it covers are solid.
+
+    @param voxels The full resolution voxels of the chunk.
+    @param factor The number of voxels along each axis that make up one cell.
+    @param solidCellCount Set to the number of solid cells.
+    @param scratch Where to allocate the cells. When null, they are allocated with AllocateVoxels().
+    @return The downsampled cells, free with FreeVoxels() unless they were allocated from scratch.
+*/
+int*** DownsampleVoxels(int*** voxels, int factor, int& solidCellCount, ScratchArena* scratch = nullptr);
+
+/**
+    Downsample only the layer of cells on one face of a chunk. O(n^2 * factor)
+
+    Cells are solid by the same rule as DownsampleVoxels(), so the layer matches the cells the chunk meshes itself with.
+    Used to cull against a neighbour at the same level of detail, which only reads the layer bordering it.
+
+    @param face The face of the downsampled chunk whose layer is computed.
+    @return A cube of cells from scratch, only the cells of the face's layer are set.
+*/
+int*** DownsampleFace(int*** voxels, int factor, ChunkFace face, ScratchArena& scratch);
+
+/**
+    Sample the terrain height of a world column. O(1)
+*/
+double SampleTerrainHeight(double worldX, double worldZ);
+
+/**
+    Generate the voxels of the chunk at the given location from the terrain. O(n^3)
+
+    Chunks entirely above or below the terrain are not allocated.
+*/
+TerrainVoxels GenerateTerrainVoxels(glm::vec3 location);
+
+#endif
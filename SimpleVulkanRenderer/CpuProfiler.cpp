@@ -0,0 +1,156 @@
+#include "CpuProfiler.hpp"
+
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    struct ProfileEvent
+    {
+        const char* Name;
+        uint64_t Start;
+        uint64_t End;
+    };
+
+    /**
+     * A fixed block of events. Only the owning thread writes, publishing each event by bumping Count,
+     * so readers never see a half written event.
+     */
+    struct EventBlock
+    {
+        static constexpr size_t CAPACITY = 4096;
+
+        ProfileEvent Events[CAPACITY];
+        std::atomic<size_t> Count{ 0 };
+        std::atomic<EventBlock*> Next{ nullptr };
+    };
+
+    struct ThreadBuffer
+    {
+        uint32_t ThreadId;
+        // Guarded by bufferMutex.
+        std::string ThreadName;
+        // Null until the thread records its first zone.
+        std::atomic<EventBlock*> Head{ nullptr };
+        // Only touched by the owning thread.
+        EventBlock* Tail = nullptr;
+
+        ~ThreadBuffer()
+        {
+            EventBlock* block = Head.load(std::memory_order_acquire);
+            while (block != nullptr)
+            {
+                EventBlock* next = block->Next.load(std::memory_order_acquire);
+                delete block;
+                block = next;
+            }
+        }
+    };
+
+    // Only locked when a thread first records or names itself, or when the trace is written.
+    std::mutex bufferMutex;
+    // Kept until the program exits, the events must outlive their threads.
+    std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+
+    thread_local ThreadBuffer* currentThreadBuffer = nullptr;
+
+    ThreadBuffer* CurrentThreadBuffer()
+    {
+        if (currentThreadBuffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(bufferMutex);
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->ThreadId = static_cast<uint32_t>(threadBuffers.size());
+            buffer->ThreadName = "Thread " + std::to_string(buffer->ThreadId);
+            currentThreadBuffer = buffer.get();
+            threadBuffers.push_back(std::move(buffer));
+        }
+        return currentThreadBuffer;
+    }
+
+    void WriteEscaped(std::ofstream& file, const std::string& text)
+    {
+        for (char character : text)
+        {
+            if (character == '"' || character == '\\')
+            {
+                file << '\\';
+            }
+            file << character;
+        }
+    }
+}
+
+void CpuProfiler::Record(const char* name, uint64_t start, uint64_t end)
+{
+    ThreadBuffer* buffer = CurrentThreadBuffer();
+    EventBlock* block = buffer->Tail;
+    size_t count = block != nullptr ? block->Count.load(std::memory_order_relaxed) : 0;
+    if (block == nullptr)
+    {
+        block = new EventBlock();
+        buffer->Head.store(block, std::memory_order_release);
+        buffer->Tail = block;
+    }
+    else if (count == EventBlock::CAPACITY)
+    {
+        EventBlock* next = new EventBlock();
+        block->Next.store(next, std::memory_order_release);
+        buffer->Tail = next;
+        block = next;
+        count = 0;
+    }
+
+    block->Events[count] = { name, start, end };
+    block->Count.store(count + 1, std::memory_order_release);
+}
+
+void CpuProfiler::SetThreadName(const std::string& name)
+{
+    ThreadBuffer* buffer = CurrentThreadBuffer();
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    buffer->ThreadName = name;
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(bufferMutex);
+    // Microseconds with nanosecond precision, never in scientific notation.
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    for (auto& buffer : threadBuffers)
+    {
+        file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->ThreadId << ",\"args\":{\"name\":\"";
+        WriteEscaped(file, buffer->ThreadName);
+        file << "\"}}";
+        first = false;
+
+        for (EventBlock* block = buffer->Head.load(std::memory_order_acquire); block != nullptr; block = block->Next.load(std::memory_order_acquire))
+        {
+            size_t count = block->Count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; i++)
+            {
+                const ProfileEvent& event = block->Events[i];
+                // Complete events, timestamps are in microseconds.
+                file << ",\n{\"name\":\"";
+                WriteEscaped(file, event.Name);
+                file << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->ThreadId
+                    << ",\"ts\":" << event.Start / 1000.0 << ",\"dur\":" << (event.End - event.Start) / 1000.0 << "}";
+            }
+        }
+    }
+    file << "\n]}\n";
+
+    return file.good();
+}
@@ -0,0 +1,116 @@
+#pragma once
+#ifndef CPU_PROFILER_H
+#define CPU_PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Set to 0 (for example from the compiler's preprocessor definitions) to compile every zone out.
+#ifndef CPU_PROFILER_ENABLED
+#define CPU_PROFILER_ENABLED 1
+#endif
+
+/// <summary>
+/// Records how long named zones of code take on every thread, to be viewed as a Chrome trace (chrome://tracing or Perfetto).
+///
+/// Every thread appends to its own buffer without locking. Buffers are kept after their thread exits,
+/// so the zones of finished loading threads still show in the trace.
+/// Nothing is recorded, and nothing allocated, until capturing is turned on.
+/// </summary>
+class CpuProfiler
+{
+public:
+	/// <summary>
+	/// Start or stop recording zones. Zones that begin while capturing is off are skipped.
+	/// </summary>
+	static void SetCapturing(bool capturing)
+	{
+		sCapturing.store(capturing, std::memory_order_relaxed);
+	}
+
+	static bool IsCapturing()
+	{
+		return sCapturing.load(std::memory_order_relaxed);
+	}
+
+	/// <summary>
+	/// Nanoseconds since the profiler was first used.
+	/// </summary>
+	static uint64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Epoch()).count();
+	}
+
+	/// <summary>
+	/// Record a zone of the calling thread.
+	/// </summary>
+	/// <param name="name">Must stay valid until the trace is written, such as a string literal.</param>
+	static void Record(const char* name, uint64_t start, uint64_t end);
+
+	/// <summary>
+	/// Name the calling thread in the trace.
+	/// </summary>
+	static void SetThreadName(const std::string& name);
+
+	/// <summary>
+	/// Write every zone recorded so far as Chrome trace event JSON.
+	///
+	/// Can be called while other threads are still recording, their newest zones may be missing.
+	/// </summary>
+	/// <returns>If the file could be written.</returns>
+	static bool WriteChromeTrace(const std::string& path);
+
+private:
+	static inline std::atomic<bool> sCapturing{ false };
+
+	static std::chrono::steady_clock::time_point Epoch()
+	{
+		static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+		return epoch;
+	}
+};
+
+/// <summary>
+/// Records a zone from its construction until it goes out of scope. Use CPU_PROFILE_ZONE() rather than this directly.
+/// </summary>
+class CpuProfileZone
+{
+public:
+	CpuProfileZone(const char* name)
+		:
+		mName(CpuProfiler::IsCapturing() ? name : nullptr),
+		mStart(mName != nullptr ? CpuProfiler::Now() : 0)
+	{
+	}
+
+	~CpuProfileZone()
+	{
+		if (mName != nullptr)
+		{
+			CpuProfiler::Record(mName, mStart, CpuProfiler::Now());
+		}
+	}
+
+	CpuProfileZone(const CpuProfileZone&) = delete;
+	CpuProfileZone& operator=(const CpuProfileZone&) = delete;
+
+private:
+	const char* mName;
+	uint64_t mStart;
+};
+
+#define CPU_PROFILE_CONCAT_INNER(a, b) a##b
+#define CPU_PROFILE_CONCAT(a, b) CPU_PROFILE_CONCAT_INNER(a, b)
+
+#if CPU_PROFILER_ENABLED
+// Time the rest of the enclosing scope. The name must be a string literal.
+#define CPU_PROFILE_ZONE(name) CpuProfileZone CPU_PROFILE_CONCAT(cpuProfileZone, __LINE__)(name)
+#define CPU_PROFILE_THREAD_NAME(name) CpuProfiler::SetThreadName(name)
+#else
+#define CPU_PROFILE_ZONE(name) ((void)0)
+#define CPU_PROFILE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif
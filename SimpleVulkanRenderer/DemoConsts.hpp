@@ -3,4 +3,18 @@
 
 constexpr auto CHUNK_VOXEL_COUNT = 16;
 
+// Each level of detail halves the voxel resolution of a chunk, level 3 meshes 8x8x8 voxels as one.
+constexpr auto CHUNK_LOD_COUNT = 4;
+// The distance (in voxels) from the camera past which a chunk switches to the next level of detail.
+constexpr float CHUNK_LOD_DISTANCES[CHUNK_LOD_COUNT - 1] = { 48, 96, 192 };
+
+// Pass each chunk's origin as a push constant (shaders/chunk_push.vert) instead of giving every chunk
+// a mapped buffer holding its model matrix as an instance attribute.
+// Requires shaders/vert_push.spv, built by shaders/compile.bat.
+constexpr bool CHUNK_PUSH_CONSTANT_TRANSFORMS = false;
+
+// Keep a compressed CPU copy of every chunk mesh after upload (see MeshCompression.hpp), so a mesh evicted
+// to stay within the memory budget is uploaded again without remeshing. Otherwise the CPU mesh is freed after upload.
+constexpr bool CHUNK_RETAIN_COMPRESSED_MESHES = false;
+
 #endif
\ No newline at end of file
@@ -0,0 +1,16 @@
+#ifndef GLM_INCLUDES
+#define GLM_INCLUDES
+
+// Every translation unit has to see glm with the same configuration, or the types differ in layout.
+#define GLM_FORCE_RADIANS
+// Fix alignment with uniforms
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+// Configure GLM to use depth from 0 to 1.
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+#endif
@@ -2,29 +2,21 @@
 #ifndef GREEDY_MESH_H
 #define GREEDY_MESH_H
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-#include <glm/gtx/hash.hpp>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <array>
 #include <unordered_set>
 #include <string.h>
 #include <queue>
 
-#include "Queue.h"
 #include "3DArray.h"
+#include "ChunkNeighbours.hpp"
 
-#include "VulkanRendererTypes.hpp"
-
-/**
-
-    The output of the voxel greedy mesh aglorithm.
-
-*/
-struct AlgorithmOutput {
-    std::vector<Vertex> verticies;
-    std::vector<uint32_t> indicies;
-};
+// Only the vertex type is needed, the mesher does not depend on Vulkan or GLFW.
+#include "Vertex.hpp"
+#include "MeshSink.hpp"
+#include "MeshingArena.hpp"
 
 // Macros to define 1/3 and 2/3
 #define ONE_THIRD (1/3)
@@ -37,10 +29,10 @@ constexpr auto BROWN = glm::vec3(0.588, 0.31, 0.008);
     Add the front face of a voxel to the output. O(1)
 
     @param pos The position of the voxel
-    @param output The output to add to.
+    @param output The sink to add to.
     @param i The current indices value.
 */
-void getFront(glm::vec3 position, AlgorithmOutput& output, int i) {
+void getFront(glm::vec3 position, MeshSink& output, uint32_t i) {
     Vertex v1;
     v1.pos = glm::vec3(-0.5f + position.x, 0.5f + position.y, 0.5f + position.z);
     v1.color = BROWN;
@@ -58,26 +50,19 @@ void getFront(glm::vec3 position, AlgorithmOutput& output, int i) {
     v4.color = BROWN;
     v4.texCoord = glm::vec2(1, 1);
 
-    output.verticies.push_back(v1);
-    output.verticies.push_back(v2);
-    output.verticies.push_back(v3);
-    output.verticies.push_back(v4);
-    output.indicies.push_back(i);
-    output.indicies.push_back(i + 1);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 3);
-    output.indicies.push_back(i);
+    const Vertex vertices[4] = { v1, v2, v3, v4 };
+    const uint32_t indices[6] = { i, i + 1, i + 2, i + 2, i + 3, i };
+    output.AddQuad(vertices, indices);
 }
 
 /**
     Add the back face of a voxel to the output. O(1)
 
     @param pos The position of the voxel
-    @param output The output to add to.
+    @param output The sink to add to.
     @param i The current indices value.
 */
-void getBack(glm::vec3 pos, AlgorithmOutput& output, int i) {
+void getBack(glm::vec3 pos, MeshSink& output, uint32_t i) {
     Vertex v1;
     v1.pos = glm::vec3(-0.5f + pos.x, 0.5f + pos.y, -0.5f + pos.z);
     v1.color = BROWN;
@@ -95,26 +80,19 @@ void getBack(glm::vec3 pos, AlgorithmOutput& output, int i) {
     v4.color = BROWN;
     v4.texCoord = glm::vec2(1, 0);
 
-    output.verticies.push_back(v1);
-    output.verticies.push_back(v2);
-    output.verticies.push_back(v3);
-    output.verticies.push_back(v4);
-    output.indicies.push_back(i);
-    output.indicies.push_back(i + 3);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 1);
-    output.indicies.push_back(i);
+    const Vertex vertices[4] = { v1, v2, v3, v4 };
+    const uint32_t indices[6] = { i, i + 3, i + 2, i + 2, i + 1, i };
+    output.AddQuad(vertices, indices);
 }
 
 /**
     Add the top face of a voxel to the output. O(1)
 
     @param pos The position of the voxel
-    @param output The output to add to.
+    @param output The sink to add to.
     @param i The current indices value.
 */
-void getTop(glm::vec3 pos, AlgorithmOutput& output, int i) {
+void getTop(glm::vec3 pos, MeshSink& output, uint32_t i) {
     Vertex v1;
     v1.pos = glm::vec3(-0.5f + pos.x, 0.5f + pos.y, -0.5f + pos.z);
     v1.color = GREEN;
@@ -132,26 +110,19 @@ void getTop(glm::vec3 pos, AlgorithmOutput& output, int i) {
     v4.color = GREEN;
     v4.texCoord = glm::vec2(0, 1);
 
-    output.verticies.push_back(v1);
-    output.verticies.push_back(v2);
-    output.verticies.push_back(v3);
-    output.verticies.push_back(v4);
-    output.indicies.push_back(i);
-    output.indicies.push_back(i + 1);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 3);
-    output.indicies.push_back(i);
+    const Vertex vertices[4] = { v1, v2, v3, v4 };
+    const uint32_t indices[6] = { i, i + 1, i + 2, i + 2, i + 3, i };
+    output.AddQuad(vertices, indices);
 }
 
 /**
     Add the bottom face of a voxel to the output. O(1)
 
     @param pos The position of the voxel
-    @param output The output to add to.
+    @param output The sink to add to.
     @param i The current indices value.
 */
-void getBottom(glm::vec3 pos, AlgorithmOutput& output, int i) {
+void getBottom(glm::vec3 pos, MeshSink& output, uint32_t i) {
     Vertex v1;
     v1.pos = glm::vec3(-0.5f + pos.x, -0.5f + pos.y, -0.5f + pos.z);
     v1.color = BROWN;
@@ -169,26 +140,19 @@ void getBottom(glm::vec3 pos, AlgorithmOutput& output, int i) {
     v4.color = BROWN;
     v4.texCoord = glm::vec2(1, 1);
 
-    output.verticies.push_back(v1);
-    output.verticies.push_back(v2);
-    output.verticies.push_back(v3);
-    output.verticies.push_back(v4);
-    output.indicies.push_back(i);
-    output.indicies.push_back(i + 3);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 1);
-    output.indicies.push_back(i);
+    const Vertex vertices[4] = { v1, v2, v3, v4 };
+    const uint32_t indices[6] = { i, i + 3, i + 2, i + 2, i + 1, i };
+    output.AddQuad(vertices, indices);
 }
 
 /**
     Add the right face of a voxel to the output. O(1)
 
     @param pos The position of the voxel
-    @param output The output to add to.
+    @param output The sink to add to.
     @param i The current indices value.
 */
-void getRight(glm::vec3 pos, AlgorithmOutput& output, int i) {
+void getRight(glm::vec3 pos, MeshSink& output, uint32_t i) {
     Vertex v1;
     v1.pos = glm::vec3(0.5f + pos.x, 0.5f + pos.y, 0.5f + pos.z);
     v1.color = BROWN;
@@ -206,26 +170,19 @@ void getRight(glm::vec3 pos, AlgorithmOutput& output, int i) {
     v4.color = BROWN;
     v4.texCoord = glm::vec2(1, 1);
 
-    output.verticies.push_back(v1);
-    output.verticies.push_back(v2);
-    output.verticies.push_back(v3);
-    output.verticies.push_back(v4);
-    output.indicies.push_back(i); 
-    output.indicies.push_back(i + 1); 
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 3);
-    output.indicies.push_back(i);
+    const Vertex vertices[4] = { v1, v2, v3, v4 };
+    const uint32_t indices[6] = { i, i + 1, i + 2, i + 2, i + 3, i };
+    output.AddQuad(vertices, indices);
 }
 
 /**
     Add the left face of a voxel to the output. O(1)
 
     @param pos The position of the voxel
-    @param output The output to add to.
+    @param output The sink to add to.
     @param i The current indices value.
 */
-void getLeft(glm::vec3 pos, AlgorithmOutput& output, int i) {
+void getLeft(glm::vec3 pos, MeshSink& output, uint32_t i) {
     Vertex v1;
     v1.pos = glm::vec3(-0.5f + pos.x, 0.5f + pos.y, -0.5f + pos.z);
     v1.color = BROWN;
@@ -243,31 +200,62 @@ void getLeft(glm::vec3 pos, AlgorithmOutput& output, int i) {
     v4.color = BROWN;
     v4.texCoord = glm::vec2(1, 1);
 
-    output.verticies.push_back(v1);
-    output.verticies.push_back(v2);
-    output.verticies.push_back(v3);
-    output.verticies.push_back(v4);
-    output.indicies.push_back(i);
-    output.indicies.push_back(i + 1);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 2);
-    output.indicies.push_back(i + 3);
-    output.indicies.push_back(i);
+    const Vertex vertices[4] = { v1, v2, v3, v4 };
+    const uint32_t indices[6] = { i, i + 1, i + 2, i + 2, i + 3, i };
+    output.AddQuad(vertices, indices);
 }
 
 bool checkBounds(glm::vec3 vec, int chunkSize);
 int getChunkData(int*** chunkArray, int realChunkSize, glm::vec3 vec);
+bool isNeighbourSolid(const ChunkNeighbours* neighbours, int realChunkSize, glm::vec3 vec);
 
-AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelCount) {
-    int totalIterations = 0;
+/**
+    The most quads the greedy mesh algorithm can emit for a chunk. O(1)
 
-    AlgorithmOutput output;
-    if (voxelCount == 0) return output;
+    Every quad lies between a solid voxel and air, so there are at most six per solid voxel
+    and at most one per face of the voxel grid.
+
+    @param voxelCount The number of solid voxels, or -1 if unknown.
+*/
+size_t maxMeshQuads(int chunkSize, int voxelCount) {
+    size_t gridFaces = (size_t)3 * chunkSize * chunkSize * (chunkSize + 1);
+    if (voxelCount < 0) return gridFaces;
+    if (voxelCount == chunkSize * chunkSize * chunkSize) return (size_t)6 * chunkSize * chunkSize;
+    return std::min((size_t)6 * voxelCount, gridFaces);
+}
+
+/**
+    A guess at the quads the greedy mesh algorithm emits for a chunk, to size its output before meshing. O(1)
+
+    Terrain rarely has more surface than the bounding box of its chunk, so that is the guess.
+    Noisy or hollow chunks go over it, so outputs sized from it must be able to grow.
+
+    @param voxelCount The number of solid voxels, or -1 if unknown.
+*/
+size_t estimateMeshQuads(int chunkSize, int voxelCount) {
+    return std::min((size_t)6 * chunkSize * chunkSize, maxMeshQuads(chunkSize, voxelCount));
+}
+
+/**
+    Generate the mesh of a chunk into a sink.
+
+    @param output The sink every quad is added to.
+    @param chunkArray The voxels of the chunk. May be null if the chunk is full.
+    @param chunkSize The number of voxels along each axis.
+    @param voxelCount The number of solid voxels, or -1 if unknown.
+    @param neighbours Views of the six neighbouring chunks. Faces hidden by a solid neighbour are not emitted.
+        When null, everything outside of the chunk is treated as air.
+    @param scratch Where the working memory of the flood fill is allocated, reused between chunks to avoid allocating.
+        When null, it is allocated for this chunk alone.
+*/
+void greedyMeshAlgorithm(MeshSink& output, int*** chunkArray, int chunkSize, int voxelCount, const ChunkNeighbours* neighbours = nullptr, ScratchArena* scratch = nullptr) {
+    if (voxelCount == 0) return;
     // Edge Case: If the entire chunk is full.
     if (voxelCount == chunkSize * chunkSize * chunkSize) {
         int i = 0;
         for (int x = 0; x < chunkSize; x++) {
             for (int y = 0; y < chunkSize; y++) {
+                if (isNeighbourSolid(neighbours, chunkSize, glm::vec3(x + 1, y + 1, 0))) continue;
                 // O(1)
                 getBack(glm::vec3(x, y, 0), output, i);
                 i+=4;
@@ -275,6 +263,7 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         }
         for (int x = 0; x < chunkSize; x++) {
             for (int y = 0; y < chunkSize; y++) {
+                if (isNeighbourSolid(neighbours, chunkSize, glm::vec3(x + 1, y + 1, chunkSize + 1))) continue;
                 // O(1)
                 getFront(glm::vec3(x, y, chunkSize - 1), output, i);
                 i += 4;
@@ -282,45 +271,55 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         }
         for (int z = 0; z < chunkSize; z++) {
             for (int y = 0; y < chunkSize; y++) {
+                if (isNeighbourSolid(neighbours, chunkSize, glm::vec3(0, y + 1, z + 1))) continue;
                 getLeft(glm::vec3(0, y, z), output, i);
                 i += 4;
             }
         }
         for (int z = 0; z < chunkSize; z++) {
             for (int y = 0; y < chunkSize; y++) {
+                if (isNeighbourSolid(neighbours, chunkSize, glm::vec3(chunkSize + 1, y + 1, z + 1))) continue;
                 getRight(glm::vec3(chunkSize - 1, y, z), output, i);
                 i += 4;
             }
         }
         for (int x = 0; x < chunkSize; x++) {
             for (int z = 0; z < chunkSize; z++) {
+                if (isNeighbourSolid(neighbours, chunkSize, glm::vec3(x + 1, chunkSize + 1, z + 1))) continue;
                 getTop(glm::vec3(x, chunkSize-1, z), output, i);
                 i += 4;
             }
         }
         for (int x = 0; x < chunkSize; x++) {
             for (int z = 0; z < chunkSize; z++) {
+                if (isNeighbourSolid(neighbours, chunkSize, glm::vec3(x + 1, 0, z + 1))) continue;
                 getBottom(glm::vec3(x, 0, z), output, i);
                 i += 4;
             }
         }
-        return output;
+        return;
     }
     int i = 0;
     int nChunkSize = chunkSize + 2;
-    // Initalize pi 3d array.
-    ThreeDArray<int> pi(nChunkSize);
+    size_t paddedVoxelCount = (size_t)nChunkSize * nChunkSize * nChunkSize;
+    ScratchArena chunkScratch;
+    ScratchArena& arena = scratch != nullptr ? *scratch : chunkScratch;
+    // Initalize pi 3d array. Only marks visited voxels, so a byte each is enough.
+    ThreeDArray<uint8_t> pi(nChunkSize, arena.Allocate<uint8_t>(paddedVoxelCount));
     pi.zeroOut(); // Zero out the 3D array O(n) (Faster than manual for loop in practice)
     
-    std::queue<glm::vec3> voxelsToVisit;
+    // Every voxel is queued at most once, the moment it is marked in pi.
+    ScratchQueue<glm::vec3> voxelsToVisit(arena, paddedVoxelCount);
+
 
+    // The flood fill runs on the padded grid, faces are emitted in chunk coordinates like the full chunk case.
+    const glm::vec3 paddingOffset = glm::vec3(1, 1, 1);
 
     glm::vec3 firstEdge = glm::vec3(0, 0, 0);
     pi.set(firstEdge, 1); // O(1)
     voxelsToVisit.push(firstEdge); // Add to the queue. O(1)
     // Worst case: O((n+2)^3)
     while (!voxelsToVisit.empty()) {
-        totalIterations++;
         glm::vec3 voxelToProccess = voxelsToVisit.front(); // Get the front of the queue. O(1)
         voxelsToVisit.pop(); // Pop from the queue. O(1)
 
@@ -329,8 +328,11 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         if (checkBounds(checkVoxel, nChunkSize)
             && pi.at(checkVoxel) == 0) {
             if (getChunkData(chunkArray, chunkSize, checkVoxel) == 1) {
-                getBack(checkVoxel, output, i);
-                i += 4;
+                // Faces against a solid voxel of a neighbouring chunk are hidden.
+                if (!isNeighbourSolid(neighbours, chunkSize, voxelToProccess)) {
+                    getBack(checkVoxel - paddingOffset, output, i);
+                    i += 4;
+                }
             }
             else {
                 voxelsToVisit.push(checkVoxel);
@@ -343,8 +345,11 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         if (checkBounds(checkVoxel, nChunkSize)
             && pi.at(checkVoxel) == 0) {
             if (getChunkData(chunkArray, chunkSize, checkVoxel) == 1) {
-                getFront(checkVoxel, output, i);
-                i += 4;
+                // Faces against a solid voxel of a neighbouring chunk are hidden.
+                if (!isNeighbourSolid(neighbours, chunkSize, voxelToProccess)) {
+                    getFront(checkVoxel - paddingOffset, output, i);
+                    i += 4;
+                }
             }
             else {
                 voxelsToVisit.push(checkVoxel);
@@ -356,8 +361,11 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         if (checkBounds(checkVoxel, nChunkSize)
             && pi.at(checkVoxel) == 0) {
             if (getChunkData(chunkArray, chunkSize, checkVoxel) == 1) {
-                getBottom(checkVoxel, output, i);
-                i += 4;
+                // Faces against a solid voxel of a neighbouring chunk are hidden.
+                if (!isNeighbourSolid(neighbours, chunkSize, voxelToProccess)) {
+                    getBottom(checkVoxel - paddingOffset, output, i);
+                    i += 4;
+                }
             }
             else {
                 voxelsToVisit.push(checkVoxel);
@@ -369,8 +377,11 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         if (checkBounds(checkVoxel, nChunkSize)
             && pi.at(checkVoxel) == 0) {
             if (getChunkData(chunkArray, chunkSize, checkVoxel) == 1) {
-                getTop(checkVoxel, output, i);
-                i += 4;
+                // Faces against a solid voxel of a neighbouring chunk are hidden.
+                if (!isNeighbourSolid(neighbours, chunkSize, voxelToProccess)) {
+                    getTop(checkVoxel - paddingOffset, output, i);
+                    i += 4;
+                }
             }
             else {
                 voxelsToVisit.push(checkVoxel);
@@ -383,8 +394,11 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         if (checkBounds(checkVoxel, nChunkSize)
             && pi.at(checkVoxel) == 0) {
             if (getChunkData(chunkArray, chunkSize, checkVoxel) == 1) {
-                getLeft(checkVoxel, output, i);
-                i += 4;
+                // Faces against a solid voxel of a neighbouring chunk are hidden.
+                if (!isNeighbourSolid(neighbours, chunkSize, voxelToProccess)) {
+                    getLeft(checkVoxel - paddingOffset, output, i);
+                    i += 4;
+                }
             }
             else {
                 voxelsToVisit.push(checkVoxel);
@@ -397,8 +411,11 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
         if (checkBounds(checkVoxel, nChunkSize)
             && pi.at(checkVoxel) == 0) {
             if (getChunkData(chunkArray, chunkSize, checkVoxel) == 1) {
-                getRight(checkVoxel, output, i);
-                i += 4;
+                // Faces against a solid voxel of a neighbouring chunk are hidden.
+                if (!isNeighbourSolid(neighbours, chunkSize, voxelToProccess)) {
+                    getRight(checkVoxel - paddingOffset, output, i);
+                    i += 4;
+                }
             }
             else {
                 voxelsToVisit.push(checkVoxel);
@@ -407,7 +424,16 @@ AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelC
 
         }
     }
-    std::cout << "Voxel Greedy Mesh Algorithm completed in: " << totalIterations << " iterations." << std::endl;
+}
+
+/**
+    Generate the mesh of a chunk into vectors.
+
+    @see greedyMeshAlgorithm(MeshSink&, int***, int, int, const ChunkNeighbours*, ScratchArena*)
+*/
+AlgorithmOutput greedyMeshAlgorithm(int*** chunkArray, int chunkSize, int voxelCount, const ChunkNeighbours* neighbours = nullptr) {
+    AlgorithmOutput output;
+    greedyMeshAlgorithm(output, chunkArray, chunkSize, voxelCount, neighbours);
     return output;
 }
 
@@ -421,6 +447,31 @@ int getChunkData(int*** chunkArray, int realChunkSize, glm::vec3 vec) {
     return chunkArray[(int)vec.x-1][(int)vec.y-1][(int)vec.z-1];
 }
 
+/**
+    Check if the padded voxel position lies inside a neighbouring chunk and is solid there. O(1)
+
+    Only the six face neighbours are known, edges and corners are treated as air.
+*/
+bool isNeighbourSolid(const ChunkNeighbours* neighbours, int realChunkSize, glm::vec3 vec) {
+    if (neighbours == nullptr) return false;
+    int x = (int)vec.x - 1;
+    int y = (int)vec.y - 1;
+    int z = (int)vec.z - 1;
+    int outsideAxes = (x < 0 || x >= realChunkSize) + (y < 0 || y >= realChunkSize) + (z < 0 || z >= realChunkSize);
+    if (outsideAxes != 1) return false;
+
+    const ChunkNeighbourView* view;
+    if (x < 0) { view = &(*neighbours)[LEFT_FACE]; x = realChunkSize - 1; }
+    else if (x >= realChunkSize) { view = &(*neighbours)[RIGHT_FACE]; x = 0; }
+    else if (y < 0) { view = &(*neighbours)[BOTTOM_FACE]; y = realChunkSize - 1; }
+    else if (y >= realChunkSize) { view = &(*neighbours)[TOP_FACE]; y = 0; }
+    else if (z < 0) { view = &(*neighbours)[BACK_FACE]; z = realChunkSize - 1; }
+    else { view = &(*neighbours)[FRONT_FACE]; z = 0; }
+
+    if (view->Voxels == nullptr) return view->UniformValue == 1;
+    return view->Voxels[x][y][z] == 1;
+}
+
 /**
     Check if vector is within the voxel chunk borders. O(1)
 */
@@ -0,0 +1,122 @@
+#include "MeshCompression.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    /**
+        Find the winding of every quad, made of four vertices and six indices. O(n)
+
+        @return False if the indices are not made of separate quads or have more than 256 windings.
+    */
+    bool CompressQuadWindings(const std::vector<uint32_t>& indices, size_t vertexCount, CompressedMesh& output)
+    {
+        if (indices.size() % 6 != 0 || indices.size() / 6 * 4 != vertexCount) return false;
+
+        output.QuadWindings.resize(indices.size() / 6);
+        for (size_t quad = 0; quad < output.QuadWindings.size(); quad++)
+        {
+            std::array<uint8_t, 6> winding;
+            for (int i = 0; i < 6; i++)
+            {
+                uint32_t index = indices[quad * 6 + i];
+                if (index < quad * 4 || index >= quad * 4 + 4) return false;
+                winding[i] = static_cast<uint8_t>(index - quad * 4);
+            }
+
+            size_t entry = std::find(output.Windings.begin(), output.Windings.end(), winding) - output.Windings.begin();
+            if (entry == output.Windings.size())
+            {
+                if (entry > std::numeric_limits<uint8_t>::max()) return false;
+                output.Windings.push_back(winding);
+            }
+            output.QuadWindings[quad] = static_cast<uint8_t>(entry);
+        }
+        return true;
+    }
+
+    bool QuantizePosition(float value, int16_t& output)
+    {
+        float steps = value * 2;
+        if (steps != std::floor(steps) || steps < std::numeric_limits<int16_t>::min() || steps > std::numeric_limits<int16_t>::max()) return false;
+
+        output = static_cast<int16_t>(steps);
+        return true;
+    }
+}
+
+size_t CompressedMesh::Bytes() const
+{
+    return sizeof(CompressedMesh) + Palette.capacity() * sizeof(PaletteEntry) + Positions.capacity() * sizeof(int16_t)
+        + PaletteIndices.capacity() * sizeof(uint8_t) + Windings.capacity() * sizeof(std::array<uint8_t, 6>)
+        + QuadWindings.capacity() * sizeof(uint8_t) + Indices.capacity() * sizeof(uint32_t);
+}
+
+bool CompressMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, CompressedMesh& output)
+{
+    output = CompressedMesh();
+    output.VertexCount = static_cast<uint32_t>(vertices.size());
+    output.IndexCount = static_cast<uint32_t>(indices.size());
+    output.Positions.resize(vertices.size() * 3);
+    output.PaletteIndices.resize(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex& vertex = vertices[i];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (!QuantizePosition(vertex.pos[axis], output.Positions[i * 3 + axis])) return false;
+        }
+
+        // The palette is tiny (two colors for the terrain), a linear search beats hashing.
+        size_t entry = 0;
+        while (entry < output.Palette.size() && (output.Palette[entry].Color != vertex.color || output.Palette[entry].TexCoord != vertex.texCoord))
+        {
+            entry++;
+        }
+        if (entry == output.Palette.size())
+        {
+            if (entry > std::numeric_limits<uint8_t>::max()) return false;
+            output.Palette.push_back({ vertex.color, vertex.texCoord });
+        }
+        output.PaletteIndices[i] = static_cast<uint8_t>(entry);
+    }
+
+    if (!CompressQuadWindings(indices, vertices.size(), output))
+    {
+        output.Windings.clear();
+        output.QuadWindings.clear();
+        output.Indices = indices;
+    }
+    return true;
+}
+
+void DecompressMesh(const CompressedMesh& mesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+    vertices.resize(mesh.VertexCount);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        vertices[i].pos = glm::vec3(mesh.Positions[i * 3], mesh.Positions[i * 3 + 1], mesh.Positions[i * 3 + 2]) * 0.5f;
+        const auto& entry = mesh.Palette[mesh.PaletteIndices[i]];
+        vertices[i].color = entry.Color;
+        vertices[i].texCoord = entry.TexCoord;
+    }
+
+    if (mesh.QuadWindings.empty())
+    {
+        indices = mesh.Indices;
+        return;
+    }
+
+    indices.resize(mesh.IndexCount);
+    for (size_t quad = 0; quad < mesh.QuadWindings.size(); quad++)
+    {
+        const auto& winding = mesh.Windings[mesh.QuadWindings[quad]];
+        for (int i = 0; i < 6; i++)
+        {
+            indices[quad * 6 + i] = static_cast<uint32_t>(quad * 4 + winding[i]);
+        }
+    }
+}
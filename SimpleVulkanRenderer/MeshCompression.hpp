@@ -0,0 +1,58 @@
+#pragma once
+#ifndef MESH_COMPRESSION_H
+#define MESH_COMPRESSION_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.hpp"
+
+/**
+
+    A compact copy of a chunk mesh, kept on the CPU so the mesh can be uploaded again without remeshing.
+
+    Positions are stored as 16 bit half voxel steps and the color and texture coordinate of each vertex
+    as an index into a palette. Meshes made of separate quads, like the greedy mesher outputs, store the
+    winding of each quad as an index into a palette of windings instead of its six indices.
+    A quad takes 29 bytes instead of 152.
+
+*/
+struct CompressedMesh {
+    struct PaletteEntry {
+        glm::vec3 Color;
+        glm::vec2 TexCoord;
+    };
+
+    uint32_t VertexCount = 0;
+    uint32_t IndexCount = 0;
+    std::vector<PaletteEntry> Palette;
+    // Three per vertex.
+    std::vector<int16_t> Positions;
+    std::vector<uint8_t> PaletteIndices;
+    // The six indices of a quad relative to its first vertex, and the winding of each quad.
+    std::vector<std::array<uint8_t, 6>> Windings;
+    std::vector<uint8_t> QuadWindings;
+    // Only used when the indices are not made of separate quads.
+    std::vector<uint32_t> Indices;
+
+    /**
+        The bytes held by the compressed mesh. O(1)
+    */
+    size_t Bytes() const;
+};
+
+/**
+    Compress a mesh. O(n)
+
+    @return False if the mesh can't be stored exactly, such as positions that are not on a half voxel
+        or more than 256 distinct colors and texture coordinates.
+*/
+bool CompressMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, CompressedMesh& output);
+
+/**
+    Restore the exact vertices and indices of a compressed mesh. O(n)
+*/
+void DecompressMesh(const CompressedMesh& mesh, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+#endif
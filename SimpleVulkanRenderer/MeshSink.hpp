@@ -0,0 +1,45 @@
+#pragma once
+#ifndef MESH_SINK_H
+#define MESH_SINK_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.hpp"
+
+/**
+
+    Receives the quads of the voxel greedy mesh algorithm as they are emitted.
+
+    Lets the mesher write somewhere other than a vector, such as straight into mapped staging memory.
+
+*/
+class MeshSink {
+public:
+    virtual ~MeshSink() = default;
+
+    /**
+        Add a quad to the output.
+
+        @param vertices The four vertices of the quad.
+        @param indices The six indices of the quad's two triangles, counted from the first vertex of the mesh.
+    */
+    virtual void AddQuad(const Vertex* vertices, const uint32_t* indices) = 0;
+};
+
+/**
+
+    The output of the voxel greedy mesh aglorithm.
+
+*/
+struct AlgorithmOutput : public MeshSink {
+    std::vector<Vertex> verticies;
+    std::vector<uint32_t> indicies;
+
+    void AddQuad(const Vertex* vertices, const uint32_t* indices) override {
+        verticies.insert(verticies.end(), vertices, vertices + 4);
+        indicies.insert(indicies.end(), indices, indices + 6);
+    }
+};
+
+#endif
@@ -0,0 +1,123 @@
+#pragma once
+#ifndef MESHING_ARENA_H
+#define MESHING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "MeshSink.hpp"
+
+/**
+
+    A bump allocator for scratch memory that is all released at once by Reset().
+
+    Allocations that do not fit the block go to extra blocks. Reset() replaces them with one block big enough
+    for everything allocated since the last reset, so once an arena has been through a few chunks it stops allocating.
+    No constructors or destructors are run, only use it for trivially copyable types.
+
+*/
+class ScratchArena {
+public:
+    ScratchArena() : mBlockSize(0), mUsed(0), mOverflowBytes(0) {}
+
+    ScratchArena(const ScratchArena&) = delete;
+    ScratchArena& operator=(const ScratchArena&) = delete;
+
+    /**
+        Allocate uninitialized memory for count values, valid until the next Reset(). O(1)
+    */
+    template <class T>
+    T* Allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+        size_t offset = (mUsed + alignof(T) - 1) / alignof(T) * alignof(T);
+        if (offset + bytes <= mBlockSize) {
+            mUsed = offset + bytes;
+            return reinterpret_cast<T*>(mBlock.get() + offset);
+        }
+
+        // new[] aligns for any fundamental type.
+        mOverflow.push_back(std::make_unique<char[]>(bytes));
+        mOverflowBytes += bytes + alignof(std::max_align_t);
+        return reinterpret_cast<T*>(mOverflow.back().get());
+    }
+
+    /**
+        Release everything allocated, growing the block to fit it all next time. O(1) unless the block grows.
+    */
+    void Reset() {
+        if (!mOverflow.empty()) {
+            mBlockSize = mUsed + mOverflowBytes;
+            mBlock = std::make_unique<char[]>(mBlockSize);
+            mOverflow.clear();
+            mOverflowBytes = 0;
+        }
+        mUsed = 0;
+    }
+
+    /**
+        The bytes held by the arena. O(1)
+    */
+    size_t Bytes() const {
+        return mBlockSize + mOverflowBytes;
+    }
+
+private:
+    std::unique_ptr<char[]> mBlock;
+    size_t mBlockSize;
+    size_t mUsed;
+    std::vector<std::unique_ptr<char[]>> mOverflow;
+    size_t mOverflowBytes;
+};
+
+/**
+
+    A first in first out queue of fixed capacity, stored in a scratch arena.
+
+    Used for flood fills, which push every cell at most once, so the capacity is the number of cells.
+
+*/
+template <class T>
+class ScratchQueue {
+public:
+    ScratchQueue(ScratchArena& arena, size_t capacity)
+        : mValues(arena.Allocate<T>(capacity)), mFront(0), mBack(0) {}
+
+    bool empty() const { return mFront == mBack; }
+    const T& front() const { return mValues[mFront]; }
+    void push(const T& value) { mValues[mBack++] = value; }
+    void pop() { mFront++; }
+
+private:
+    T* mValues;
+    size_t mFront;
+    size_t mBack;
+};
+
+/**
+
+    The memory a meshing thread reuses for every chunk it meshes: scratch for the mesher and a mesh output.
+
+    Not thread safe, every thread that meshes creates its own. Reset it before each chunk.
+
+*/
+struct MeshingArena {
+    ScratchArena Scratch;
+    // Cleared rather than freed, so it keeps the capacity of the biggest mesh so far.
+    AlgorithmOutput Output;
+
+    void Reset() {
+        Scratch.Reset();
+        Output.verticies.clear();
+        Output.indicies.clear();
+    }
+
+    /**
+        The bytes held by the arena. O(1)
+    */
+    size_t Bytes() const {
+        return Scratch.Bytes() + Output.verticies.capacity() * sizeof(Vertex) + Output.indicies.capacity() * sizeof(uint32_t);
+    }
+};
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include "GlmIncludes.hpp"
+
+/**
+
+    The struct that stores information about verticies.
+
+    Kept free of Vulkan so the mesher can be used without it, see VertexBindingDescription() for the vertex input layout.
+
+*/
+struct Vertex {
+    glm::vec3 pos;
+    glm::vec3 color;
+    glm::vec2 texCoord;
+
+    bool operator==(const Vertex& other) const {
+        return pos == other.pos && color == other.color && texCoord == other.texCoord;
+    }
+};
+
+/**
+    A hash function for the Vertex. (This is not used by the algorithm)
+*/
+namespace std {
+    template<> struct hash<Vertex> {
+        size_t operator()(Vertex const& vertex) const {
+            return ((hash<glm::vec3>()(vertex.pos) ^
+                (hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
+                (hash<glm::vec2>()(vertex.texCoord) << 1);
+        }
+    };
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "VulkanBuffer.hpp"
+#include "VulkanMemoryStats.hpp"
 
 VulkanBuffer::VulkanBuffer()
 	:
@@ -17,6 +18,7 @@ VulkanBuffer::VulkanBuffer(VkBuffer buffer, VkDeviceMemory deviceMemory)
 void VulkanBuffer::DestoryBuffer(VkDevice device)
 {
 	vkDestroyBuffer(device, mInternalBuffer, nullptr);
+	VulkanMemoryStats::ReleaseDeviceMemory(mInternalMemory);
 	vkFreeMemory(device, mInternalMemory, nullptr);
 	mInternalBuffer = nullptr;
 	mInternalMemory = nullptr;
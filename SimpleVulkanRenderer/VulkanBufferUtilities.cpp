@@ -1,12 +1,11 @@
 #include "VulkanBufferUtilities.hpp"
+#include "CpuProfiler.hpp"
 #include "VulkanCommandBuffer.hpp"
+#include "VulkanMemoryStats.hpp"
 
 namespace
 {
-    uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties memProperties;
-        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
+    uint32_t FindMemoryType(const VkPhysicalDeviceMemoryProperties& memProperties, uint32_t typeFilter, VkMemoryPropertyFlags properties) {
         for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
         {
             if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
@@ -26,6 +25,7 @@ VulkanBufferUtilities::VulkanBufferUtilities(VkPhysicalDevice physicalDevice, Vk
     mDefaultCommandPool(defaultCommandPool),
     mDefaultGraphicsQueue(defaultGraphicsQueue)
 {
+    vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &mMemoryProperties);
 }
 
 void VulkanBufferUtilities::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& outBuffer, VkDeviceMemory& outBufferMemory)
@@ -48,13 +48,19 @@ void VulkanBufferUtilities::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags u
     VkMemoryAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
     allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(mPhysicalDevice, memRequirements.memoryTypeBits, properties);
+    allocInfo.memoryTypeIndex = FindMemoryType(mMemoryProperties, memRequirements.memoryTypeBits, properties);
 
     if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &outBufferMemory) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to allocate buffer memory!");
     }
 
+    // Buffers that are only ever copied from are the staging buffers of uploads.
+    VulkanMemoryCategory category = HOST_VISIBLE_MEMORY;
+    if (properties & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) category = DEVICE_LOCAL_MEMORY;
+    else if (usage == VK_BUFFER_USAGE_TRANSFER_SRC_BIT) category = STAGING_MEMORY;
+    VulkanMemoryStats::TrackDeviceMemory(outBufferMemory, category, memRequirements.size, mMemoryProperties.memoryTypes[allocInfo.memoryTypeIndex].heapIndex);
+
     // Associate the created memory with the buffer.
     vkBindBufferMemory(mDevice, outBuffer, outBufferMemory, 0);
 }
@@ -67,29 +73,84 @@ VulkanBuffer VulkanBufferUtilities::CreateBuffer(VkDeviceSize size, VkBufferUsag
     return buffer;
 }
 
-void VulkanBufferUtilities::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkCommandPool commandPool, VkQueue queue)
+void VulkanBufferUtilities::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, Ptr(VulkanCommandPool) commandPool, VkQueue queue)
 {
-    
-    VkCommandPool usedCommandPool = mDefaultCommandPool;
-    if (commandPool != VK_NULL_HANDLE)
-    {
-        usedCommandPool = commandPool;
-    }
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = 0;
+    copyRegion.dstOffset = 0;
+    copyRegion.size = size;
+    CopyBuffers({ { srcBuffer, dstBuffer, copyRegion } }, commandPool, queue);
+}
 
+void VulkanBufferUtilities::CopyBuffers(const std::vector<VulkanBufferCopy>& copies, Ptr(VulkanCommandPool) commandPool, VkQueue queue)
+{
     VkQueue usedQueue = mDefaultGraphicsQueue;
     if (queue != VK_NULL_HANDLE)
     {
         usedQueue = queue;
     }
 
-    auto commandBuffer = CreateSingleUseCommandBuffer(mDevice, usedCommandPool);
+    // A transient pool hands out its buffers in order and recycles them all at once on Reset(),
+    // so uploads neither allocate nor free command buffers.
+    bool acquired = commandPool != nullptr && commandPool->Transient();
+    std::shared_ptr<VulkanCommandBuffer> commandBuffer;
+    if (acquired)
+    {
+        commandBuffer = commandPool->AcquireCommandBuffer(mDevice);
+        commandBuffer->StartSingleUseCommandRecording();
+    }
+    else
+    {
+        commandBuffer = CreateSingleUseCommandBuffer(mDevice, commandPool != nullptr ? commandPool->CommandPool() : mDefaultCommandPool);
+    }
 
-    VkBufferCopy copyRegion{};
-    copyRegion.srcOffset = 0;
-    copyRegion.dstOffset = 0;
-    copyRegion.size = size;
-    commandBuffer->CopyBuffer(srcBuffer, dstBuffer, copyRegion);
-    commandBuffer->SubmitSingleUseCommand(mDevice, usedQueue);
+    for (const auto& copy : copies)
+    {
+        commandBuffer->CopyBuffer(copy.Source, copy.Destination, copy.Region);
+    }
+
+    if (acquired)
+    {
+        commandBuffer->SubmitAndWait(usedQueue);
+    }
+    else
+    {
+        commandBuffer->SubmitSingleUseCommand(mDevice, usedQueue);
+    }
+}
+
+VulkanMappedBuffer VulkanBufferUtilities::CreateStagingBuffer(VkDeviceSize size)
+{
+    VulkanMappedBuffer buffer;
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer, buffer);
+    vkMapMemory(mDevice, buffer, 0, size, 0, buffer.DirectMappedMemory());
+    return buffer;
+}
+
+void VulkanBufferUtilities::DestroyStagingBuffer(VulkanMappedBuffer& buffer)
+{
+    if (!buffer.Initialized()) return;
+
+    vkUnmapMemory(mDevice, buffer);
+    *buffer.DirectMappedMemory() = nullptr;
+    buffer.DestoryBuffer(mDevice);
+}
+
+void VulkanBufferUtilities::CreateDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& outBuffer, VkDeviceMemory& outBufferMemory, Ptr(VulkanCommandPool) commandPool, VkQueue queue)
+{
+    VulkanMappedBuffer stagingBuffer = CreateStagingBuffer(size);
+
+    // Copy the data to the buffer.
+    {
+        CPU_PROFILE_ZONE("Staging");
+        memcpy(stagingBuffer.MappedMemory(), data, (size_t)size);
+    }
+
+    CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, outBuffer, outBufferMemory);
+
+    CopyBuffer(stagingBuffer, outBuffer, size, commandPool, queue);
+
+    DestroyStagingBuffer(stagingBuffer);
 }
 
 void VulkanBufferUtilities::MapMemory(VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize bufferSize, VkMemoryMapFlags flags, void** data)
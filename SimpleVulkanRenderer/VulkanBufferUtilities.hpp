@@ -4,7 +4,26 @@
 
 #include "VulkanIncludes.hpp"
 #include "VulkanBuffer.hpp"
+#include "VulkanMappedBuffer.hpp"
+#include "VulkanCommandPool.hpp"
+#include "VulkanMemoryStats.hpp"
+
+/// <summary>
+/// One region to copy from a buffer to another.
+/// </summary>
+struct VulkanBufferCopy
+{
+	VkBuffer Source;
+	VkBuffer Destination;
+	VkBufferCopy Region;
+};
 
+/// <summary>
+/// Creates buffers and uploads data to them.
+///
+/// Every buffer memory allocation is counted by VulkanMemoryStats, in the device local, host visible
+/// or staging category depending on its memory properties and usage.
+/// </summary>
 class VulkanBufferUtilities
 {
 public:
@@ -12,74 +31,94 @@ public:
 	
 	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& outBuffer, VkDeviceMemory& bufferMemory);
 	VulkanBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
-	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkCommandPool commandPool = nullptr, VkQueue queue = nullptr);
+	void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr);
+
+	/// <summary>
+	/// Record every copy into one command buffer and wait for it to finish.
+	///
+	/// With a transient pool the command buffer is acquired from it and recycled by its next Reset(),
+	/// so the pool must belong to the calling thread. Otherwise a single use buffer is allocated and freed.
+	/// </summary>
+	void CopyBuffers(const std::vector<VulkanBufferCopy>& copies, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr);
+
+	/// <summary>
+	/// Create a host visible buffer to upload from, mapped until it is destroyed.
+	/// </summary>
+	VulkanMappedBuffer CreateStagingBuffer(VkDeviceSize size);
+	void DestroyStagingBuffer(VulkanMappedBuffer& buffer);
 
 	// ---------------------------------------------------
 	// Specific Buffer Creation
 	// ---------------------------------------------------
+	/// <summary>
+	/// Create a device local vertex buffer holding count elements of data, uploaded through a staging buffer.
+	///
+	/// The data is copied once, straight into the mapped staging memory, so it can point into any storage.
+	/// </summary>
 	template<typename T>
-	void CreateVertexBuffer(std::vector<T> vertexData, VkBuffer& outVertexBuffer, VkDeviceMemory& outVertexBufferMemory, VkCommandPool commandPool = nullptr, VkQueue queue = nullptr)
+	void CreateVertexBuffer(const T* data, size_t count, VkBuffer& outVertexBuffer, VkDeviceMemory& outVertexBufferMemory, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
 	{
-		VkDeviceSize bufferSize = sizeof(vertexData[0]) * vertexData.size();
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-
-		CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		// Copy the vertex data to the buffer.
-		void* data;
-		vkMapMemory(mDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertexData.data(), (size_t)bufferSize);
-		vkUnmapMemory(mDevice, stagingBufferMemory);
-
-		CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, outVertexBuffer, outVertexBufferMemory);
-
-		CopyBuffer(stagingBuffer, outVertexBuffer, bufferSize, commandPool, queue);
-
-		vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-		vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+		CreateDeviceLocalBuffer(data, sizeof(T) * count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, outVertexBuffer, outVertexBufferMemory, commandPool, queue);
 	}
 
 	template<typename T>
-	VulkanBuffer CreateVertexBuffer(std::vector<T> vertexData, VkCommandPool commandPool = nullptr, VkQueue queue = nullptr)
+	VulkanBuffer CreateVertexBuffer(const T* data, size_t count, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
 	{
 		VulkanBuffer buffer;
-		CreateVertexBuffer(vertexData, buffer, buffer, commandPool, queue);
+		CreateVertexBuffer(data, count, buffer, buffer, commandPool, queue);
 		return buffer;
 	}
 
 	template<typename T>
-	void CreateIndexBuffer(std::vector<T> indexData, VkBuffer& outIndexBuffer, VkDeviceMemory& outIndexBufferMemory, VkCommandPool commandPool = nullptr, VkQueue queue = nullptr)
+	void CreateVertexBuffer(const std::vector<T>& vertexData, VkBuffer& outVertexBuffer, VkDeviceMemory& outVertexBufferMemory, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
 	{
-		VkDeviceSize bufferSize = sizeof(indexData[0]) * indexData.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-
-		CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		// Copy the index data to the buffer.
-		void* data;
-		vkMapMemory(mDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indexData.data(), (size_t)bufferSize);
-		vkUnmapMemory(mDevice, stagingBufferMemory);
-
-		CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, outIndexBuffer, outIndexBufferMemory);
+		CreateVertexBuffer(vertexData.data(), vertexData.size(), outVertexBuffer, outVertexBufferMemory, commandPool, queue);
+	}
 
-		CopyBuffer(stagingBuffer, outIndexBuffer, bufferSize, commandPool, queue);
+	template<typename T>
+	VulkanBuffer CreateVertexBuffer(const std::vector<T>& vertexData, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
+	{
+		return CreateVertexBuffer(vertexData.data(), vertexData.size(), commandPool, queue);
+	}
 
-		vkDestroyBuffer(mDevice, stagingBuffer, nullptr);
-		vkFreeMemory(mDevice, stagingBufferMemory, nullptr);
+	/// <summary>
+	/// Create a device local index buffer holding count elements of data, uploaded through a staging buffer.
+	///
+	/// The data is copied once, straight into the mapped staging memory, so it can point into any storage.
+	/// </summary>
+	template<typename T>
+	void CreateIndexBuffer(const T* data, size_t count, VkBuffer& outIndexBuffer, VkDeviceMemory& outIndexBufferMemory, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
+	{
+		CreateDeviceLocalBuffer(data, sizeof(T) * count, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, outIndexBuffer, outIndexBufferMemory, commandPool, queue);
 	}
 
 	template<typename T>
-	VulkanBuffer CreateIndexBuffer(std::vector<T> indexData, VkCommandPool commandPool = nullptr, VkQueue queue = nullptr)
+	VulkanBuffer CreateIndexBuffer(const T* data, size_t count, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
 	{
 		VulkanBuffer buffer;
-		CreateIndexBuffer(indexData, buffer, buffer, commandPool, queue);
+		CreateIndexBuffer(data, count, buffer, buffer, commandPool, queue);
 		return buffer;
 	}
 
+	template<typename T>
+	void CreateIndexBuffer(const std::vector<T>& indexData, VkBuffer& outIndexBuffer, VkDeviceMemory& outIndexBufferMemory, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
+	{
+		CreateIndexBuffer(indexData.data(), indexData.size(), outIndexBuffer, outIndexBufferMemory, commandPool, queue);
+	}
+
+	template<typename T>
+	VulkanBuffer CreateIndexBuffer(const std::vector<T>& indexData, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr)
+	{
+		return CreateIndexBuffer(indexData.data(), indexData.size(), commandPool, queue);
+	}
+
+	/// <summary>
+	/// Create a device local buffer with the given usage and upload size bytes of data to it through a staging buffer.
+	///
+	/// The vertex and index buffer templates all end up here, so none of them copy their data anywhere but the staging memory.
+	/// </summary>
+	void CreateDeviceLocalBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& outBuffer, VkDeviceMemory& outBufferMemory, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr);
+
 	// ---------------------------------------------------
 	// Buffer Memory Mapping
 	// ---------------------------------------------------
@@ -99,6 +138,7 @@ private:
 	VkDevice mDevice;
 	VkCommandPool mDefaultCommandPool;
 	VkQueue mDefaultGraphicsQueue;
+	VkPhysicalDeviceMemoryProperties mMemoryProperties;
 };
 
 #endif
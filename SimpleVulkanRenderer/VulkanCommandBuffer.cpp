@@ -1,17 +1,22 @@
 #include "VulkanCommandBuffer.hpp"
+#include "CpuProfiler.hpp"
 
 #include <array>
 #include <stdexcept>
 
-VulkanCommandBuffer::VulkanCommandBuffer(VkDevice device, VkCommandPool parentPool, std::thread::id parentPoolId)
+VulkanCommandBuffer::VulkanCommandBuffer(VkDevice device, VkCommandPool parentPool, std::thread::id parentPoolId, VkCommandBufferLevel level)
 	:
 	mParentPoolThread(parentPoolId),
-	mParentPool(parentPool)
+	mTrackState(false),
+	mParentPool(parentPool),
+	mLevel(level)
 {
+	ClearTrackedState();
+
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = parentPool;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.level = level;
 	allocInfo.commandBufferCount = 1;
 
 	if (vkAllocateCommandBuffers(device, &allocInfo, &mCommandBuffer) != VK_SUCCESS)
@@ -20,8 +25,35 @@ VulkanCommandBuffer::VulkanCommandBuffer(VkDevice device, VkCommandPool parentPo
 	}
 }
 
+void VulkanCommandBuffer::SetStateTracking(bool enabled)
+{
+	mTrackState = enabled;
+	ClearTrackedState();
+}
+
+void VulkanCommandBuffer::ClearTrackedState()
+{
+	mStatistics = {};
+	ClearBoundState();
+}
+
+void VulkanCommandBuffer::ClearBoundState()
+{
+	mBoundPipeline = VK_NULL_HANDLE;
+	mBoundPipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	mBoundSetLayout = VK_NULL_HANDLE;
+	mBoundDescriptorSet = VK_NULL_HANDLE;
+	mBoundSetBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	mBoundVertexBuffers.clear();
+	mBoundIndexBuffer = VK_NULL_HANDLE;
+	mBoundIndexOffset = 0;
+	mBoundIndexType = VK_INDEX_TYPE_UINT32;
+}
+
 void VulkanCommandBuffer::StartCommandRecording()
 {
+	ClearTrackedState();
+
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
@@ -36,11 +68,42 @@ void VulkanCommandBuffer::StartSingleUseCommandRecording()
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	ClearTrackedState();
 
 	vkBeginCommandBuffer(mCommandBuffer, &beginInfo);
 }
 
-void VulkanCommandBuffer::StartRenderPass(VkRenderPass renderPass, VkFramebuffer frameBuffer, VkExtent2D extent, VkClearColorValue clearColor, VkClearDepthStencilValue depthStencil)
+void VulkanCommandBuffer::StartSecondaryCommandRecording(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer frameBuffer, bool reusable)
+{
+	if (mLevel != VK_COMMAND_BUFFER_LEVEL_SECONDARY)
+	{
+		throw std::runtime_error("Only secondary command buffers can continue a render pass!");
+	}
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = renderPass;
+	inheritanceInfo.subpass = subpass;
+	// Optional, but lets the driver optimize for the framebuffer it will be executed in.
+	inheritanceInfo.framebuffer = frameBuffer;
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	if (!reusable)
+	{
+		beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	}
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	ClearTrackedState();
+
+	if (vkBeginCommandBuffer(mCommandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to begin recording secondary command buffer!");
+	}
+}
+
+void VulkanCommandBuffer::StartRenderPass(VkRenderPass renderPass, VkFramebuffer frameBuffer, VkExtent2D extent, VkClearColorValue clearColor, VkClearDepthStencilValue depthStencil, VkSubpassContents contents)
 {
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -57,41 +120,119 @@ void VulkanCommandBuffer::StartRenderPass(VkRenderPass renderPass, VkFramebuffer
 	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 	renderPassInfo.pClearValues = clearValues.data();
 
-	vkCmdBeginRenderPass(mCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(mCommandBuffer, &renderPassInfo, contents);
 }
 
 void VulkanCommandBuffer::BindPipeline(VkPipeline pipeline, VkPipelineBindPoint bindPoint)
 {
+	if (mTrackState)
+	{
+		if (mBoundPipeline == pipeline && mBoundPipelineBindPoint == bindPoint)
+		{
+			mStatistics.Elided++;
+			return;
+		}
+		mBoundPipeline = pipeline;
+		mBoundPipelineBindPoint = bindPoint;
+	}
+	mStatistics.Issued++;
 	vkCmdBindPipeline(mCommandBuffer, bindPoint, pipeline);
 }
 
 void VulkanCommandBuffer::BindVertexBuffer(VkBuffer buffer, VkDeviceSize offset, uint32_t firstBinding)
 {
 	VkBuffer vertexBuffers[] = { buffer };
-	VkDeviceSize offsets[] = { 0 };
+	VkDeviceSize offsets[] = { offset };
 	BindVertexBuffers(vertexBuffers, offsets, 1, firstBinding);
 }
 
 void VulkanCommandBuffer::BindVertexBuffers(VkBuffer buffers[], VkDeviceSize offsets[], uint32_t bufferCount, uint32_t firstBinding)
 {
+	if (mTrackState)
+	{
+		if (mBoundVertexBuffers.size() < firstBinding + bufferCount)
+		{
+			mBoundVertexBuffers.resize(firstBinding + bufferCount, { VK_NULL_HANDLE, 0 });
+		}
+
+		bool alreadyBound = true;
+		for (uint32_t i = 0; i < bufferCount; i++)
+		{
+			const BoundVertexBuffer& bound = mBoundVertexBuffers[firstBinding + i];
+			if (bound.Buffer != buffers[i] || bound.Offset != offsets[i])
+			{
+				alreadyBound = false;
+				break;
+			}
+		}
+
+		if (alreadyBound)
+		{
+			mStatistics.Elided++;
+			return;
+		}
+
+		for (uint32_t i = 0; i < bufferCount; i++)
+		{
+			mBoundVertexBuffers[firstBinding + i] = { buffers[i], offsets[i] };
+		}
+	}
+	mStatistics.Issued++;
 	vkCmdBindVertexBuffers(mCommandBuffer, firstBinding, bufferCount, buffers, offsets);
 }
 
 void VulkanCommandBuffer::BindIndexBuffer(VkBuffer indexBuffer, VkDeviceSize offset, VkIndexType indexType)
 {
+	if (mTrackState)
+	{
+		if (mBoundIndexBuffer == indexBuffer && mBoundIndexOffset == offset && mBoundIndexType == indexType)
+		{
+			mStatistics.Elided++;
+			return;
+		}
+		mBoundIndexBuffer = indexBuffer;
+		mBoundIndexOffset = offset;
+		mBoundIndexType = indexType;
+	}
+	mStatistics.Issued++;
 	vkCmdBindIndexBuffer(mCommandBuffer, indexBuffer, offset, indexType);
 }
 
 void VulkanCommandBuffer::BindDescriptorSet(VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, VkPipelineBindPoint bindPoint)
 {
+	if (mTrackState)
+	{
+		if (mBoundDescriptorSet == descriptorSet && mBoundSetLayout == pipelineLayout && mBoundSetBindPoint == bindPoint)
+		{
+			mStatistics.Elided++;
+			return;
+		}
+		mBoundDescriptorSet = descriptorSet;
+		mBoundSetLayout = pipelineLayout;
+		mBoundSetBindPoint = bindPoint;
+	}
+	mStatistics.Issued++;
 	vkCmdBindDescriptorSets(mCommandBuffer, bindPoint, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
 }
 
+void VulkanCommandBuffer::PushConstants(VkPipelineLayout pipelineLayout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* data)
+{
+	vkCmdPushConstants(mCommandBuffer, pipelineLayout, stageFlags, offset, size, data);
+}
+
 void VulkanCommandBuffer::DrawIndexed(uint32_t indexSize, uint32_t instanceCount, uint32_t firstIndex, uint32_t vertexOffset, uint32_t firstInstace)
 {
 	vkCmdDrawIndexed(mCommandBuffer, indexSize, instanceCount, firstIndex, vertexOffset, firstInstace);
 }
 
+void VulkanCommandBuffer::ExecuteCommands(const std::vector<VkCommandBuffer>& commandBuffers)
+{
+	if (commandBuffers.empty()) return;
+	vkCmdExecuteCommands(mCommandBuffer, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
+	// The state bound before is undefined after executing secondary buffers, so everything must be bound again.
+	ClearBoundState();
+}
+
 void VulkanCommandBuffer::SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth)
 {
 	VkViewport viewport{};
@@ -206,6 +347,16 @@ void VulkanCommandBuffer::TransitionImageLayout(VkImage image, VkFormat format,
 	);
 }
 
+void VulkanCommandBuffer::ResetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount)
+{
+	vkCmdResetQueryPool(mCommandBuffer, queryPool, firstQuery, queryCount);
+}
+
+void VulkanCommandBuffer::WriteTimestamp(VkPipelineStageFlagBits stage, VkQueryPool queryPool, uint32_t query)
+{
+	vkCmdWriteTimestamp(mCommandBuffer, stage, queryPool, query);
+}
+
 void VulkanCommandBuffer::EndRenderPass()
 {
 	vkCmdEndRenderPass(mCommandBuffer);
@@ -220,6 +371,12 @@ void VulkanCommandBuffer::EndCommandRecording()
 }
 
 void VulkanCommandBuffer::SubmitSingleUseCommand(VkDevice device, VkQueue queue)
+{
+	SubmitAndWait(queue);
+	vkFreeCommandBuffers(device, mParentPool, 1, &mCommandBuffer);
+}
+
+void VulkanCommandBuffer::SubmitAndWait(VkQueue queue)
 {
 	EndCommandRecording();
 	VkSubmitInfo submitInfo{};
@@ -227,10 +384,14 @@ void VulkanCommandBuffer::SubmitSingleUseCommand(VkDevice device, VkQueue queue)
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &mCommandBuffer;
 
-	vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(queue);
-
-	vkFreeCommandBuffers(device, mParentPool, 1, &mCommandBuffer);
+	{
+		CPU_PROFILE_ZONE("UploadSubmit");
+		vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	}
+	{
+		CPU_PROFILE_ZONE("UploadWait");
+		vkQueueWaitIdle(queue);
+	}
 }
 
 void VulkanCommandBuffer::Submit(VkQueue queue, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence)
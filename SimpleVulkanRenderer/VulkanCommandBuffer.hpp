@@ -3,20 +3,49 @@
 #define VULKAN_COMMAND_BUFFER_H
 
 #include <thread>
+#include <vector>
 
 #include "VulkanIncludes.hpp"
 
+/// <summary>
+/// The number of state binding commands recorded and skipped since recording started.
+/// </summary>
+struct VulkanCommandStatistics
+{
+	uint32_t Issued = 0;
+	uint32_t Elided = 0;
+};
+
 class VulkanCommandBuffer
 {
 public:
-	VulkanCommandBuffer(VkDevice device, VkCommandPool parentPool, std::thread::id parentPoolId);
+	VulkanCommandBuffer(VkDevice device, VkCommandPool parentPool, std::thread::id parentPoolId, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	/// <summary>
+	/// Track the bound pipeline, descriptor set, vertex buffers and index buffer, and skip binds of state that is already bound.
+	/// 
+	/// The tracked state is cleared whenever recording starts. Do not enable this if commands are recorded
+	/// into the buffer without going through this class.
+	/// </summary>
+	void SetStateTracking(bool enabled);
 
 	// ---------------------------------------------------
 	// Starts
 	// ---------------------------------------------------
 	void StartCommandRecording();
 	void StartSingleUseCommandRecording();
-	void StartRenderPass(VkRenderPass renderPass, VkFramebuffer frameBuffer, VkExtent2D extent, VkClearColorValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f }, VkClearDepthStencilValue depthStencil = { 1.0f, 0 });
+	/// <summary>
+	/// Start recording a secondary command buffer that continues the given render pass.
+	/// 
+	/// Pipeline, viewport and scissor state is not inherited from the primary buffer and must be set again.
+	/// </summary>
+	/// <param name="frameBuffer">Optional, leave null if the buffer is executed in more than one framebuffer.</param>
+	/// <param name="reusable">If the buffer may be submitted again without being re-recorded.</param>
+	void StartSecondaryCommandRecording(VkRenderPass renderPass, uint32_t subpass, VkFramebuffer frameBuffer, bool reusable = false);
+	/// <summary>
+	/// Begin the render pass. Use VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS if the pass is filled with ExecuteCommands().
+	/// </summary>
+	void StartRenderPass(VkRenderPass renderPass, VkFramebuffer frameBuffer, VkExtent2D extent, VkClearColorValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f }, VkClearDepthStencilValue depthStencil = { 1.0f, 0 }, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
 	// ---------------------------------------------------
 	// Binds
 	// ---------------------------------------------------
@@ -25,16 +54,24 @@ public:
 	void BindVertexBuffers(VkBuffer buffers[], VkDeviceSize offsets[], uint32_t bufferCount, uint32_t firstBinding = 0);
 	void BindIndexBuffer(VkBuffer indexBuffer, VkDeviceSize offset = 0, VkIndexType indexType = VK_INDEX_TYPE_UINT32);
 	void BindDescriptorSet(VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+	void PushConstants(VkPipelineLayout pipelineLayout, VkShaderStageFlags stageFlags, uint32_t offset, uint32_t size, const void* data);
 	// ---------------------------------------------------
 	// Draw
 	// ---------------------------------------------------
 	void DrawIndexed(uint32_t indexSize, uint32_t instanceCount = 1, uint32_t firstIndex = 0, uint32_t vertexOffset = 0, uint32_t firstInstace = 0);
+	/// <summary>
+	/// Execute secondary command buffers from this primary buffer. Forgets the tracked binds, they are undefined afterwards.
+	/// </summary>
+	void ExecuteCommands(const std::vector<VkCommandBuffer>& commandBuffers);
 	// ---------------------------------------------------
 	// State Setting
 	// ---------------------------------------------------
 	void SetViewport(float x, float y, float width, float height, float minDepth, float maxDepth);
 	void SetScissor(VkOffset2D offset, VkExtent2D extent);
 	void SetViewportScissor(VkExtent2D swapChainExtent);
+	/// <summary>
+	/// Reset this buffer alone. Buffers of a transient command pool are reset through VulkanCommandPool::Reset() instead.
+	/// </summary>
 	void Reset(VkCommandBufferResetFlags resetFlags = 0);
 	// ---------------------------------------------------
 	// Memory Copying
@@ -46,6 +83,17 @@ public:
 	// ---------------------------------------------------
 	void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 	// ---------------------------------------------------
+	// Queries
+	// ---------------------------------------------------
+	/// <summary>
+	/// Reset the queries so they can be written again. Must be recorded outside of a render pass.
+	/// </summary>
+	void ResetQueryPool(VkQueryPool queryPool, uint32_t firstQuery, uint32_t queryCount);
+	/// <summary>
+	/// Write the GPU timestamp once every previous command has reached the stage.
+	/// </summary>
+	void WriteTimestamp(VkPipelineStageFlagBits stage, VkQueryPool queryPool, uint32_t query);
+	// ---------------------------------------------------
 	// Ends
 	// ---------------------------------------------------
 	void EndRenderPass();
@@ -53,7 +101,14 @@ public:
 	// ---------------------------------------------------
 	// Submit
 	// ---------------------------------------------------
+	/// <summary>
+	/// End recording, submit and wait for the queue to go idle, then free the buffer.
+	/// </summary>
 	void SubmitSingleUseCommand(VkDevice device, VkQueue queue);
+	/// <summary>
+	/// End recording, submit and wait for the queue to go idle. The buffer is kept, for buffers of a transient pool.
+	/// </summary>
+	void SubmitAndWait(VkQueue queue);
 	void Submit(VkQueue queue, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore, VkFence fence);
 	void Submit(VkQueue queue, VkSubmitInfo submitInfo, VkFence fence);
 	// ---------------------------------------------------
@@ -65,11 +120,46 @@ public:
 	{
 		return mCommandBuffer;
 	}
+
+	const VulkanCommandStatistics& Statistics() const
+	{
+		return mStatistics;
+	}
+private:
+	/// <summary>
+	/// Forget the bound state and reset the statistics.
+	/// </summary>
+	void ClearTrackedState();
+	/// <summary>
+	/// Forget the bound state, so the next bind of everything is issued. Keeps the statistics.
+	/// </summary>
+	void ClearBoundState();
+
+	struct BoundVertexBuffer
+	{
+		VkBuffer Buffer;
+		VkDeviceSize Offset;
+	};
+
 private:
 	std::thread::id mParentPoolThread;
 
+	bool mTrackState;
+	VulkanCommandStatistics mStatistics;
+	VkPipeline mBoundPipeline;
+	VkPipelineBindPoint mBoundPipelineBindPoint;
+	VkPipelineLayout mBoundSetLayout;
+	VkDescriptorSet mBoundDescriptorSet;
+	VkPipelineBindPoint mBoundSetBindPoint;
+	// Indexed by binding, a null buffer is unknown.
+	std::vector<BoundVertexBuffer> mBoundVertexBuffers;
+	VkBuffer mBoundIndexBuffer;
+	VkDeviceSize mBoundIndexOffset;
+	VkIndexType mBoundIndexType;
+
 	VkCommandBuffer mCommandBuffer;
 	VkCommandPool mParentPool;
+	VkCommandBufferLevel mLevel;
 };
 
 /// <summary>
@@ -4,10 +4,12 @@
 
 #include <stdexcept>
 
-VulkanCommandPool::VulkanCommandPool(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, std::string identifier, std::optional<VulkanQueue> vulkanQueue)
+VulkanCommandPool::VulkanCommandPool(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, std::string identifier, std::optional<VulkanQueue> vulkanQueue, bool transient)
     :
     mIdentifier(identifier),
-    mOwningThread(std::this_thread::get_id())
+    mOwningThread(std::this_thread::get_id()),
+    mTransient(transient),
+    mAcquiredCount({ 0, 0 })
 {
     QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(surface, physicalDevice);
 
@@ -15,7 +17,8 @@ VulkanCommandPool::VulkanCommandPool(VkSurfaceKHR surface, VkPhysicalDevice phys
     poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     // The graphics family queue index.
     poolInfo.queueFamilyIndex = vulkanQueue ? vulkanQueue->QueueFamily : queueFamilyIndices.graphicsFamily.value();
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    // Transient pools are only ever reset as a whole, which lets the driver skip tracking each buffer.
+    poolInfo.flags = transient ? VK_COMMAND_POOL_CREATE_TRANSIENT_BIT : VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
     if (vkCreateCommandPool(device, &poolInfo, nullptr, &mCommandPool) != VK_SUCCESS)
     {
@@ -23,14 +26,35 @@ VulkanCommandPool::VulkanCommandPool(VkSurfaceKHR surface, VkPhysicalDevice phys
     }
 }
 
-std::shared_ptr<VulkanCommandBuffer> VulkanCommandPool::CreateCommandBuffer(VkDevice device)
+std::shared_ptr<VulkanCommandBuffer> VulkanCommandPool::CreateCommandBuffer(VkDevice device, VkCommandBufferLevel level)
 {
-    auto commandBuffer = std::make_shared<VulkanCommandBuffer>(device, mCommandPool, mOwningThread);
+    auto commandBuffer = std::make_shared<VulkanCommandBuffer>(device, mCommandPool, mOwningThread, level);
     mCommandBuffers.push_back(commandBuffer);
 
     return commandBuffer;
 }
 
+std::shared_ptr<VulkanCommandBuffer> VulkanCommandPool::AcquireCommandBuffer(VkDevice device, VkCommandBufferLevel level)
+{
+    auto& buffers = mAcquiredBuffers[level];
+    size_t& count = mAcquiredCount[level];
+    if (count == buffers.size())
+    {
+        buffers.push_back(CreateCommandBuffer(device, level));
+    }
+
+    return buffers[count++];
+}
+
+void VulkanCommandPool::Reset(VkDevice device)
+{
+    if (vkResetCommandPool(device, mCommandPool, 0) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to reset command pool!");
+    }
+    mAcquiredCount = { 0, 0 };
+}
+
 void VulkanCommandPool::FreeCommandBuffers(VkDevice device)
 {
     for (auto commandBuffer : mCommandBuffers)
@@ -38,6 +62,11 @@ void VulkanCommandPool::FreeCommandBuffers(VkDevice device)
         commandBuffer->FreeCommandBuffer(device);
     }
     mCommandBuffers.clear();
+    for (auto& buffers : mAcquiredBuffers)
+    {
+        buffers.clear();
+    }
+    mAcquiredCount = { 0, 0 };
 }
 
 void VulkanCommandPool::DestroyCommandPool(VkDevice device)
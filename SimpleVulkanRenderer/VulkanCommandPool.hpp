@@ -2,6 +2,7 @@
 #ifndef VULKAN_COMMAND_POOL_H
 #define VULKAN_COMMAND_POOL_H
 
+#include <array>
 #include <string>
 #include <thread>
 #include <optional>
@@ -11,13 +12,34 @@
 
 class VulkanCommandBuffer;
 
-// TODO :: Setup so these can be reset or re-crated.
 class VulkanCommandPool
 {
 public:
-	VulkanCommandPool(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, std::string identifier, std::optional<VulkanQueue> vulkanQueue = std::nullopt);
+	/// <summary>
+	/// Create a command pool for the graphics queue family, or the family of the given queue.
+	/// </summary>
+	/// <param name="transient">
+	/// If the pool is reset as a whole with Reset() instead of per command buffer. Buffers of a transient pool
+	/// must not be reset on their own, but resetting the pool once is cheaper than resetting every buffer.
+	/// </param>
+	VulkanCommandPool(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, std::string identifier, std::optional<VulkanQueue> vulkanQueue = std::nullopt, bool transient = false);
 
-	std::shared_ptr<VulkanCommandBuffer> CreateCommandBuffer(VkDevice device);
+	std::shared_ptr<VulkanCommandBuffer> CreateCommandBuffer(VkDevice device, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	/// <summary>
+	/// Hand out the next unused command buffer of the level, allocating one only if every buffer is in use.
+	/// 
+	/// Buffers are handed out in order and all become unused again on Reset(), so after the first few
+	/// frames nothing is allocated. The same buffer objects are returned after every reset.
+	/// </summary>
+	std::shared_ptr<VulkanCommandBuffer> AcquireCommandBuffer(VkDevice device, VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	/// <summary>
+	/// Reset every command buffer of the pool with a single vkResetCommandPool() and make the acquired buffers available again.
+	/// 
+	/// None of the buffers may still be pending execution on the GPU.
+	/// </summary>
+	void Reset(VkDevice device);
 
 	void FreeCommandBuffers(VkDevice device);
 	void DestroyCommandPool(VkDevice device);
@@ -37,12 +59,22 @@ public:
 		return mCommandPool;
 	}
 
+	const bool Transient() const
+	{
+		return mTransient;
+	}
+
 private:
 	const std::string mIdentifier;
 	const std::thread::id mOwningThread;
+	const bool mTransient;
 
 	VkCommandPool mCommandPool;
 	std::vector<std::shared_ptr<VulkanCommandBuffer>> mCommandBuffers;
+
+	// Indexed by VkCommandBufferLevel, the buffers handed out by AcquireCommandBuffer() and how many are in use.
+	std::array<std::vector<std::shared_ptr<VulkanCommandBuffer>>, 2> mAcquiredBuffers;
+	std::array<size_t, 2> mAcquiredCount;
 };
 
 #endif
\ No newline at end of file
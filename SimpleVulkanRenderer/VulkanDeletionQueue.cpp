@@ -0,0 +1,65 @@
+#include "VulkanDeletionQueue.hpp"
+
+VulkanDeletionQueue::VulkanDeletionQueue(VkDevice device, int framesInFlight)
+	:
+	mDevice(device),
+	mFramesInFlight(framesInFlight),
+	mFrameNumber(0)
+{
+}
+
+void VulkanDeletionQueue::RetireBuffer(VulkanBuffer buffer)
+{
+	if (!buffer.Initialized()) return;
+
+	VkDevice device = mDevice;
+	Retire([device, buffer]() mutable {
+		buffer.DestoryBuffer(device);
+	});
+}
+
+void VulkanDeletionQueue::Retire(std::function<void()> deleter)
+{
+	std::lock_guard<std::mutex> lock(mRetiredMutex);
+	// The frame number is read after the caller unpublished the resource, so any frame that
+	// could still have picked it up is at most the current one.
+	mRetired.push_back({ mFrameNumber, std::move(deleter) });
+}
+
+void VulkanDeletionQueue::StartFrame()
+{
+	std::deque<RetiredResource> expired;
+	{
+		std::lock_guard<std::mutex> lock(mRetiredMutex);
+		while (!mRetired.empty() && mRetired.front().Frame + mFramesInFlight <= mFrameNumber)
+		{
+			expired.push_back(std::move(mRetired.front()));
+			mRetired.pop_front();
+		}
+	}
+
+	// Destroy outside of the lock so retiring threads are never held up.
+	for (auto& resource : expired)
+	{
+		resource.Deleter();
+	}
+}
+
+void VulkanDeletionQueue::EndFrame()
+{
+	mFrameNumber++;
+}
+
+void VulkanDeletionQueue::Flush()
+{
+	std::deque<RetiredResource> retired;
+	{
+		std::lock_guard<std::mutex> lock(mRetiredMutex);
+		retired.swap(mRetired);
+	}
+
+	for (auto& resource : retired)
+	{
+		resource.Deleter();
+	}
+}
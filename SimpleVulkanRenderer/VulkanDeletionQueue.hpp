@@ -0,0 +1,67 @@
+#pragma once
+#ifndef VULKAN_DELETION_QUEUE_H
+#define VULKAN_DELETION_QUEUE_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "VulkanIncludes.hpp"
+#include "VulkanBuffer.hpp"
+
+/// <summary>
+/// Defers the destruction of GPU resources until no frame in flight can still be using them.
+/// 
+/// Resources are retired with the current frame number and destroyed once that many frames in flight
+/// have passed, at which point the swapchain has waited on the fence of the frame that last used them.
+/// Resources can be retired from any thread.
+/// </summary>
+class VulkanDeletionQueue
+{
+public:
+	VulkanDeletionQueue(VkDevice device, int framesInFlight);
+
+	/// <summary>
+	/// Destroy the buffer once the current frame and the frames in flight before it have finished.
+	/// </summary>
+	void RetireBuffer(VulkanBuffer buffer);
+	/// <summary>
+	/// Run the deleter once the current frame and the frames in flight before it have finished.
+	/// </summary>
+	void Retire(std::function<void()> deleter);
+
+	/// <summary>
+	/// Destroy the resources that are no longer in use. Call after the fence of the current frame was waited on.
+	/// </summary>
+	void StartFrame();
+	/// <summary>
+	/// Advance the frame number. Call once the commands of the frame have been submitted.
+	/// </summary>
+	void EndFrame();
+	/// <summary>
+	/// Destroy every retired resource. The device must be idle.
+	/// </summary>
+	void Flush();
+
+	uint64_t CurrentFrame() const
+	{
+		return mFrameNumber;
+	}
+
+private:
+	struct RetiredResource
+	{
+		uint64_t Frame;
+		std::function<void()> Deleter;
+	};
+
+	VkDevice mDevice;
+	const int mFramesInFlight;
+	std::atomic<uint64_t> mFrameNumber;
+
+	std::mutex mRetiredMutex;
+	std::deque<RetiredResource> mRetired;
+};
+
+#endif
@@ -48,9 +48,11 @@ VulkanFragmentShader::VulkanFragmentShader(VkDevice device, std::string name, st
     this->fragmentShaderStageInfo = fragmentShaderStageInfo;
 }
 
-VkPipelineShaderStageCreateInfo VulkanFragmentShader::GetShaderStage()
+VkPipelineShaderStageCreateInfo VulkanFragmentShader::GetShaderStage(const VkSpecializationInfo* specializationInfo)
 {
-    return fragmentShaderStageInfo;
+    VkPipelineShaderStageCreateInfo stageInfo = fragmentShaderStageInfo;
+    stageInfo.pSpecializationInfo = specializationInfo;
+    return stageInfo;
 }
 
 void VulkanFragmentShader::DestroyShaderModuleIfNeeded(VkDevice device)
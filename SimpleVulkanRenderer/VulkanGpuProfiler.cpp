@@ -0,0 +1,172 @@
+#include "VulkanGpuProfiler.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace
+{
+    // Marks a scope begun after the query pool was full, it is not measured.
+    constexpr uint32_t UNMEASURED_SCOPE = UINT32_MAX;
+}
+
+VulkanGpuProfiler::VulkanGpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, int framesInFlight, uint32_t maxScopes)
+    :
+    mDevice(device),
+    mMaxScopes(maxScopes),
+    mCurrentFrame(0),
+    mResolvedFrames(0)
+{
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    mTimestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    // Zero if the family doesn't support timestamps, timestampComputeAndGraphics doesn't promise every family does.
+    uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+    mTimestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
+    mSupported = validBits != 0 && mTimestampPeriod > 0;
+
+    mScopeNames.resize(framesInFlight);
+    mScopeDepths.resize(framesInFlight);
+    if (!mSupported) return;
+
+    for (int i = 0; i < framesInFlight; i++)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = mMaxScopes * 2;
+
+        VkQueryPool queryPool;
+        if (vkCreateQueryPool(mDevice, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+        mQueryPools.push_back(queryPool);
+    }
+}
+
+void VulkanGpuProfiler::BeginFrame(Ptr(VulkanCommandBuffer) commandBuffer, size_t frame)
+{
+    if (!mSupported) return;
+
+    ResolveFrame(frame);
+
+    mCurrentFrame = frame;
+    mScopeNames[frame].clear();
+    mScopeDepths[frame].clear();
+    mOpenScopes.clear();
+    commandBuffer->ResetQueryPool(mQueryPools[frame], 0, mMaxScopes * 2);
+}
+
+void VulkanGpuProfiler::BeginScope(Ptr(VulkanCommandBuffer) commandBuffer, const std::string& name)
+{
+    if (!mSupported) return;
+
+    auto& names = mScopeNames[mCurrentFrame];
+    if (names.size() == mMaxScopes)
+    {
+        mOpenScopes.push_back(UNMEASURED_SCOPE);
+        return;
+    }
+
+    uint32_t scope = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    mScopeDepths[mCurrentFrame].push_back(static_cast<int>(mOpenScopes.size()));
+    mOpenScopes.push_back(scope);
+    commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mQueryPools[mCurrentFrame], scope * 2);
+}
+
+void VulkanGpuProfiler::EndScope(Ptr(VulkanCommandBuffer) commandBuffer)
+{
+    if (!mSupported) return;
+    if (mOpenScopes.empty())
+    {
+        throw std::runtime_error("Ended a GPU scope that was never begun!");
+    }
+
+    uint32_t scope = mOpenScopes.back();
+    mOpenScopes.pop_back();
+    if (scope == UNMEASURED_SCOPE) return;
+
+    commandBuffer->WriteTimestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mQueryPools[mCurrentFrame], scope * 2 + 1);
+}
+
+void VulkanGpuProfiler::SetLogFile(const std::string& path)
+{
+    mLogFile = std::ofstream(path, std::ios::out | std::ios::trunc);
+    if (!mLogFile.is_open())
+    {
+        throw std::runtime_error("Failed to open GPU timing log file!");
+    }
+    mLogFile << "frame,scope,depth,milliseconds\n";
+}
+
+double VulkanGpuProfiler::Milliseconds(const std::string& name) const
+{
+    for (auto& timing : mTimings)
+    {
+        if (timing.Name == name)
+        {
+            return timing.Milliseconds;
+        }
+    }
+    return 0;
+}
+
+void VulkanGpuProfiler::ResolveFrame(size_t frame)
+{
+    auto& names = mScopeNames[frame];
+    if (names.empty()) return;
+
+    // Each query is followed by its availability, so nothing waits on queries that never completed.
+    uint32_t queryCount = static_cast<uint32_t>(names.size()) * 2;
+    std::vector<uint64_t> results(queryCount * 2);
+    vkGetQueryPoolResults(mDevice, mQueryPools[frame], 0, queryCount, results.size() * sizeof(uint64_t), results.data(),
+        sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    std::vector<VulkanGpuTiming> timings;
+    for (size_t scope = 0; scope < names.size(); scope++)
+    {
+        uint64_t begin = results[scope * 4];
+        uint64_t beginAvailable = results[scope * 4 + 1];
+        uint64_t end = results[scope * 4 + 2];
+        uint64_t endAvailable = results[scope * 4 + 3];
+        // A scope that was begun but never ended, or a frame that was never submitted.
+        if (beginAvailable == 0 || endAvailable == 0) continue;
+
+        // Only the valid bits are defined, and the counter wraps around at the top of them.
+        uint64_t ticks = ((end & mTimestampMask) - (begin & mTimestampMask)) & mTimestampMask;
+        double milliseconds = ticks * mTimestampPeriod / 1000000.0;
+        timings.push_back({ names[scope], mScopeDepths[frame][scope], milliseconds });
+    }
+    if (timings.empty()) return;
+
+    mTimings = timings;
+    mResolvedFrames++;
+
+    if (mLogFile.is_open())
+    {
+        for (auto& timing : mTimings)
+        {
+            mLogFile << mResolvedFrames << "," << timing.Name << "," << timing.Depth << "," << timing.Milliseconds << "\n";
+        }
+    }
+}
+
+void VulkanGpuProfiler::DestroyQueryPools()
+{
+    for (auto queryPool : mQueryPools)
+    {
+        vkDestroyQueryPool(mDevice, queryPool, nullptr);
+    }
+    mQueryPools.clear();
+    mSupported = false;
+    if (mLogFile.is_open())
+    {
+        mLogFile.close();
+    }
+}
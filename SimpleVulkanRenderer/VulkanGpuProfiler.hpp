@@ -0,0 +1,148 @@
+#pragma once
+#ifndef VULKAN_GPU_PROFILER_H
+#define VULKAN_GPU_PROFILER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "VulkanIncludes.hpp"
+#include "VulkanCommandBuffer.hpp"
+
+/// <summary>
+/// The GPU time of one scope of a frame.
+/// </summary>
+struct VulkanGpuTiming
+{
+	std::string Name;
+	// How many scopes this one is nested in.
+	int Depth;
+	double Milliseconds;
+};
+
+/// <summary>
+/// Measures how long scopes of the frame command buffer take on the GPU with timestamp queries.
+///
+/// Every frame in flight has its own query pool. A frame's results are read when the same frame in flight starts
+/// again, after its fence has been waited on, so reading them never stalls. The timings are therefore a few frames old.
+/// </summary>
+class VulkanGpuProfiler
+{
+public:
+	/// <param name="queueFamilyIndex">The family of the queue the measured command buffers are submitted to.</param>
+	/// <param name="maxScopes">The most scopes that can be measured in one frame, further scopes are ignored.</param>
+	VulkanGpuProfiler(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, int framesInFlight, uint32_t maxScopes = 32);
+
+	/// <summary>
+	/// Read the results of the last use of this frame's queries and reset them.
+	///
+	/// Call right after the frame command buffer started recording, outside of any render pass.
+	/// The fence of the frame must have been waited on.
+	/// </summary>
+	void BeginFrame(Ptr(VulkanCommandBuffer) commandBuffer, size_t frame);
+
+	/// <summary>
+	/// Start measuring a scope. Scopes may be nested but must be ended in reverse order.
+	///
+	/// Timestamps can not be written inside a render pass whose contents are secondary command buffers,
+	/// so begin the scope before such a render pass.
+	/// </summary>
+	void BeginScope(Ptr(VulkanCommandBuffer) commandBuffer, const std::string& name);
+	void EndScope(Ptr(VulkanCommandBuffer) commandBuffer);
+
+	/// <summary>
+	/// Append the timings of every resolved frame to a CSV file (frame, scope, depth, milliseconds).
+	/// </summary>
+	void SetLogFile(const std::string& path);
+
+	/// <summary>
+	/// If the queue family supports timestamps. If not, every call does nothing and no timings are reported.
+	/// </summary>
+	bool Supported() const
+	{
+		return mSupported;
+	}
+
+	/// <summary>
+	/// The timings of the most recently resolved frame, in the order the scopes began.
+	/// </summary>
+	const std::vector<VulkanGpuTiming>& Timings() const
+	{
+		return mTimings;
+	}
+
+	/// <summary>
+	/// The milliseconds of the named scope in the most recently resolved frame, or zero if it was not measured.
+	/// </summary>
+	double Milliseconds(const std::string& name) const;
+
+	/// <summary>
+	/// The number of frames whose timings have been resolved.
+	/// </summary>
+	uint64_t ResolvedFrames() const
+	{
+		return mResolvedFrames;
+	}
+
+	void DestroyQueryPools();
+
+private:
+	void ResolveFrame(size_t frame);
+
+private:
+	VkDevice mDevice;
+	bool mSupported;
+	// Nanoseconds per timestamp tick.
+	double mTimestampPeriod;
+	// The bits of a timestamp the queue family writes, the rest are undefined.
+	uint64_t mTimestampMask;
+	uint32_t mMaxScopes;
+
+	// Indexed by frame in flight. Scope i writes queries 2i and 2i + 1.
+	std::vector<VkQueryPool> mQueryPools;
+	std::vector<std::vector<std::string>> mScopeNames;
+	std::vector<std::vector<int>> mScopeDepths;
+
+	// The frame being recorded and its open scopes.
+	size_t mCurrentFrame;
+	std::vector<uint32_t> mOpenScopes;
+
+	std::vector<VulkanGpuTiming> mTimings;
+	uint64_t mResolvedFrames;
+	std::ofstream mLogFile;
+};
+
+/// <summary>
+/// Measures the GPU time of the commands recorded while it is alive.
+/// </summary>
+class VulkanGpuScope
+{
+public:
+	VulkanGpuScope(Ptr(VulkanGpuProfiler) profiler, Ptr(VulkanCommandBuffer) commandBuffer, const std::string& name)
+		:
+		mProfiler(profiler),
+		mCommandBuffer(commandBuffer)
+	{
+		if (mProfiler != nullptr)
+		{
+			mProfiler->BeginScope(mCommandBuffer, name);
+		}
+	}
+
+	~VulkanGpuScope()
+	{
+		if (mProfiler != nullptr)
+		{
+			mProfiler->EndScope(mCommandBuffer);
+		}
+	}
+
+	VulkanGpuScope(const VulkanGpuScope&) = delete;
+	VulkanGpuScope& operator=(const VulkanGpuScope&) = delete;
+
+private:
+	Ptr(VulkanGpuProfiler) mProfiler;
+	Ptr(VulkanCommandBuffer) mCommandBuffer;
+};
+
+#endif
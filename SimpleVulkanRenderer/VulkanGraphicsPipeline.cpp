@@ -21,9 +21,15 @@ VulkanGraphicsPipeline::VulkanGraphicsPipeline(const GraphicsPipelineDescriptor
 }
 
 // TODO:: A bug needs to be fix where shaders will be killd when the window resizes.
-void VulkanGraphicsPipeline::UpdatePipeline(VkDevice device, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout)
+void VulkanGraphicsPipeline::UpdatePipeline(VkDevice device, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout, VkPipelineCache pipelineCache)
 {
-    std::vector<VkPipelineShaderStageCreateInfo> shaderStages = { mVertexShader->GetShaderStage(), mFragmentShader->GetShaderStage() };
+    // The specialization infos point into the descriptor, which outlives the pipeline creation.
+    VkSpecializationInfo vertexSpecialization = mDescriptor.VertexSpecialization.Info();
+    VkSpecializationInfo fragmentSpecialization = mDescriptor.FragmentSpecialization.Info();
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages = {
+        mVertexShader->GetShaderStage(mDescriptor.VertexSpecialization.Empty() ? nullptr : &vertexSpecialization),
+        mFragmentShader->GetShaderStage(mDescriptor.FragmentSpecialization.Empty() ? nullptr : &fragmentSpecialization)
+    };
 
     for (auto shader : mOtherShaders)
     {
@@ -119,6 +125,8 @@ void VulkanGraphicsPipeline::UpdatePipeline(VkDevice device, VkRenderPass render
     // Reference the descriptorSetLayout which contains info for the shader descriptors.
     // This is created using the createDescriptorSetLayout() method.
     pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(mDescriptor.PushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = mDescriptor.PushConstantRanges.data();
 
     if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
     {
@@ -155,11 +163,17 @@ void VulkanGraphicsPipeline::UpdatePipeline(VkDevice device, VkRenderPass render
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
     pipelineInfo.basePipelineIndex = -1;
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &mPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &mPipeline) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create a graphics pipeline!");
     }
 
+    if (!mDescriptor.DestroyShaderModules)
+    {
+        // Still needed by other permutations.
+        return;
+    }
+
     // Destory shader modules as they are no longer needed.
     mVertexShader->DestroyShaderModuleIfNeeded(device);
     mFragmentShader->DestroyShaderModuleIfNeeded(device);
@@ -22,6 +22,28 @@ struct GraphicsPipelineDescriptor
 	float LineWidth = 1.0f;
 	VkCullModeFlags CullMode = VK_CULL_MODE_BACK_BIT;
 	VkFrontFace VertexOrder = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	/// <summary>
+	/// The push constant ranges of the pipeline layout.
+	/// </summary>
+	std::vector<VkPushConstantRange> PushConstantRanges;
+
+	/// <summary>
+	/// The specialization constants of this permutation of the shaders.
+	/// </summary>
+	VulkanSpecializationConstants VertexSpecialization;
+	VulkanSpecializationConstants FragmentSpecialization;
+	/// <summary>
+	/// Identifies the permutation, it must differ for every pipeline created from the same shaders.
+	/// The pipeline compiler returns the existing pipeline when the same shaders and key are requested again.
+	/// </summary>
+	uint64_t PermutationKey = 0;
+	/// <summary>
+	/// If the shader modules are destroyed once the pipeline is created.
+	/// Set to false when building several permutations from the same shaders, then call
+	/// DestroyShaderModuleIfNeeded() on them once every permutation is created.
+	/// </summary>
+	bool DestroyShaderModules = true;
 };
 
 class VulkanGraphicsPipeline
@@ -29,12 +51,20 @@ class VulkanGraphicsPipeline
 public:
 	VulkanGraphicsPipeline(const GraphicsPipelineDescriptor descriptor);
 
-	void UpdatePipeline(VkDevice device, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout);
+	/// <summary>
+	/// Create the pipeline. Pass the renderer's pipeline cache so pipelines created in previous runs are reused.
+	/// </summary>
+	void UpdatePipeline(VkDevice device, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout, VkPipelineCache pipelineCache = VK_NULL_HANDLE);
 	void CleanupPipeline(VkDevice device);
 
 	VkPipeline Pipeline() const;
 	VkPipelineLayout PipelineLayout() const;
 
+	uint64_t PermutationKey() const
+	{
+		return mDescriptor.PermutationKey;
+	}
+
 private:
 	VkPipeline mPipeline;
 	VkPipelineLayout mPipelineLayout;
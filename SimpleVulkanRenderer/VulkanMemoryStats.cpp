@@ -0,0 +1,107 @@
+#include "VulkanMemoryStats.hpp"
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+    struct TrackedMemory
+    {
+        VulkanMemoryCategory Category;
+        VkDeviceSize Size;
+        uint32_t HeapIndex;
+    };
+
+    std::atomic<uint64_t> usedBytes[VULKAN_MEMORY_CATEGORY_COUNT];
+    std::atomic<uint64_t> peakBytes[VULKAN_MEMORY_CATEGORY_COUNT];
+    std::atomic<uint64_t> heapBytes[VK_MAX_MEMORY_HEAPS];
+
+    // Only locked when device memory is allocated or freed, which is rare compared to frames.
+    std::mutex trackedMemoryMutex;
+    std::unordered_map<VkDeviceMemory, TrackedMemory> trackedMemory;
+}
+
+void VulkanMemoryStats::Allocate(VulkanMemoryCategory category, uint64_t bytes)
+{
+    uint64_t used = usedBytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    uint64_t peak = peakBytes[category].load(std::memory_order_relaxed);
+    while (used > peak && !peakBytes[category].compare_exchange_weak(peak, used, std::memory_order_relaxed))
+    {
+    }
+}
+
+void VulkanMemoryStats::Free(VulkanMemoryCategory category, uint64_t bytes)
+{
+    usedBytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void VulkanMemoryStats::TrackDeviceMemory(VkDeviceMemory memory, VulkanMemoryCategory category, VkDeviceSize size, uint32_t heapIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(trackedMemoryMutex);
+        trackedMemory[memory] = { category, size, heapIndex };
+    }
+    Allocate(category, size);
+    heapBytes[heapIndex].fetch_add(size, std::memory_order_relaxed);
+}
+
+void VulkanMemoryStats::ReleaseDeviceMemory(VkDeviceMemory memory)
+{
+    if (memory == VK_NULL_HANDLE) return;
+
+    TrackedMemory tracked;
+    {
+        std::lock_guard<std::mutex> lock(trackedMemoryMutex);
+        auto it = trackedMemory.find(memory);
+        if (it == trackedMemory.end()) return;
+
+        tracked = it->second;
+        trackedMemory.erase(it);
+    }
+    Free(tracked.Category, tracked.Size);
+    heapBytes[tracked.HeapIndex].fetch_sub(tracked.Size, std::memory_order_relaxed);
+}
+
+uint64_t VulkanMemoryStats::Used(VulkanMemoryCategory category)
+{
+    return usedBytes[category].load(std::memory_order_relaxed);
+}
+
+uint64_t VulkanMemoryStats::Peak(VulkanMemoryCategory category)
+{
+    return peakBytes[category].load(std::memory_order_relaxed);
+}
+
+uint64_t VulkanMemoryStats::HeapUsage(uint32_t heapIndex)
+{
+    return heapBytes[heapIndex].load(std::memory_order_relaxed);
+}
+
+const char* VulkanMemoryStats::CategoryName(VulkanMemoryCategory category)
+{
+    switch (category)
+    {
+    case DEVICE_LOCAL_MEMORY: return "Device local";
+    case HOST_VISIBLE_MEMORY: return "Host visible";
+    case STAGING_MEMORY: return "Staging";
+    case CPU_VOXEL_MEMORY: return "CPU voxels";
+    case CPU_MESH_MEMORY: return "CPU meshes";
+    }
+    return "Unknown";
+}
+
+std::string VulkanMemoryStats::Report()
+{
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(2);
+    for (int i = 0; i < VULKAN_MEMORY_CATEGORY_COUNT; i++)
+    {
+        auto category = static_cast<VulkanMemoryCategory>(i);
+        report << CategoryName(category) << ": " << Used(category) / (1024.0 * 1024.0) << " MiB (peak "
+            << Peak(category) / (1024.0 * 1024.0) << " MiB)\n";
+    }
+    return report.str();
+}
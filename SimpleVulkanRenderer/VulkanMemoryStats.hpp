@@ -0,0 +1,77 @@
+#pragma once
+#ifndef VULKAN_MEMORY_STATS_H
+#define VULKAN_MEMORY_STATS_H
+
+#include <cstdint>
+#include <string>
+
+#include "VulkanIncludes.hpp"
+
+/// <summary>
+/// What a tracked allocation is used for.
+/// </summary>
+enum VulkanMemoryCategory
+{
+	DEVICE_LOCAL_MEMORY,
+	HOST_VISIBLE_MEMORY,
+	// Host visible buffers that only live for the duration of an upload.
+	STAGING_MEMORY,
+	CPU_VOXEL_MEMORY,
+	CPU_MESH_MEMORY
+};
+
+constexpr int VULKAN_MEMORY_CATEGORY_COUNT = 5;
+
+/// <summary>
+/// The size, budget and usage of one memory heap of the device.
+/// </summary>
+struct VulkanHeapBudget
+{
+	VkDeviceSize Size;
+	// How much of the heap this process can use without degrading performance.
+	VkDeviceSize Budget;
+	VkDeviceSize Usage;
+	bool DeviceLocal;
+	// If Budget and Usage were reported by VK_EXT_memory_budget. Otherwise they are estimated from the tracked allocations.
+	bool Reported;
+};
+
+/// <summary>
+/// Counts the bytes in use per memory category, for every thread.
+///
+/// Buffer memory is tracked by VulkanBufferUtilities when it is allocated and released when the buffer is destroyed,
+/// so it only needs the VkDeviceMemory handle. CPU memory is counted by whoever owns it.
+/// </summary>
+class VulkanMemoryStats
+{
+public:
+	static void Allocate(VulkanMemoryCategory category, uint64_t bytes);
+	static void Free(VulkanMemoryCategory category, uint64_t bytes);
+
+	/// <summary>
+	/// Count device memory until ReleaseDeviceMemory() is called with the same handle.
+	/// </summary>
+	static void TrackDeviceMemory(VkDeviceMemory memory, VulkanMemoryCategory category, VkDeviceSize size, uint32_t heapIndex);
+	/// <summary>
+	/// Stop counting device memory, call right before freeing it. Handles that were never tracked are ignored.
+	/// </summary>
+	static void ReleaseDeviceMemory(VkDeviceMemory memory);
+
+	static uint64_t Used(VulkanMemoryCategory category);
+	/// <summary>
+	/// The most bytes ever in use at once.
+	/// </summary>
+	static uint64_t Peak(VulkanMemoryCategory category);
+	/// <summary>
+	/// The tracked device memory allocated from the heap.
+	/// </summary>
+	static uint64_t HeapUsage(uint32_t heapIndex);
+
+	static const char* CategoryName(VulkanMemoryCategory category);
+	/// <summary>
+	/// The usage and peak of every category, one per line.
+	/// </summary>
+	static std::string Report();
+};
+
+#endif
@@ -0,0 +1,256 @@
+#include "VulkanParallelRecorder.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <string>
+
+VulkanParallelRecorder::VulkanParallelRecorder(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, int framesInFlight, int workerCount)
+    :
+    mDevice(device),
+    mRunning(true),
+    mJobGeneration(0),
+    mPendingWorkers(0),
+    mJobFrame(0),
+    mJobRenderPass(VK_NULL_HANDLE),
+    mJobFrameBuffer(VK_NULL_HANDLE),
+    mJobItemCount(0),
+    mJobReusable(false),
+    mLastRecordReused(false)
+{
+    workerCount = std::max(workerCount, 1);
+
+    mCommandPools.resize(framesInFlight, std::vector<Ptr(VulkanCommandPool)>(workerCount));
+    mCommandBuffers.resize(framesInFlight, std::vector<Ptr(VulkanCommandBuffer)>(workerCount));
+    mCacheKeys.resize(framesInFlight);
+    mCachedBuffers.resize(framesInFlight);
+
+    // Every worker creates its own pools, so they are owned by the thread that records into them.
+    mRecorded.resize(workerCount, false);
+    mPendingWorkers = workerCount;
+    for (int worker = 0; worker < workerCount; worker++)
+    {
+        mWorkers.emplace_back(&VulkanParallelRecorder::WorkerLoop, this, worker, surface, physicalDevice);
+    }
+
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(mJobMutex);
+        mDoneCondition.wait(lock, [this] { return mPendingWorkers == 0; });
+        error = mJobError;
+        mJobError = nullptr;
+    }
+    if (error != nullptr)
+    {
+        CleanUp();
+        std::rethrow_exception(error);
+    }
+}
+
+VulkanParallelRecorder::~VulkanParallelRecorder()
+{
+    CleanUp();
+}
+
+std::vector<VkCommandBuffer> VulkanParallelRecorder::Record(size_t frame, VkRenderPass renderPass, VkFramebuffer frameBuffer, size_t itemCount, RecordFunction record, const VulkanRecordingKey* cacheKey)
+{
+    CPU_PROFILE_ZONE("ParallelRecord");
+    // The buffers of this frame were last executed by the frame's previous submission, whose fence has been waited on.
+    mLastRecordReused = cacheKey != nullptr && mCacheKeys[frame] == *cacheKey;
+    if (mLastRecordReused)
+    {
+        return mCachedBuffers[frame];
+    }
+    // Recording resets the frame's buffers, so whatever was cached is gone.
+    mCacheKeys[frame] = std::nullopt;
+
+    {
+        std::unique_lock<std::mutex> lock(mJobMutex);
+        mJobFrame = frame;
+        mJobRenderPass = renderPass;
+        mJobFrameBuffer = cacheKey != nullptr ? VK_NULL_HANDLE : frameBuffer;
+        mJobReusable = cacheKey != nullptr;
+        mJobItemCount = itemCount;
+        mJobRecord = record;
+        mJobError = nullptr;
+        std::fill(mRecorded.begin(), mRecorded.end(), false);
+        mPendingWorkers = static_cast<int>(mWorkers.size());
+        mJobGeneration++;
+    }
+    mJobCondition.notify_all();
+
+    std::unique_lock<std::mutex> lock(mJobMutex);
+    mDoneCondition.wait(lock, [this] { return mPendingWorkers == 0; });
+    mJobRecord = nullptr;
+
+    if (mJobError != nullptr)
+    {
+        std::rethrow_exception(mJobError);
+    }
+
+    std::vector<VkCommandBuffer> recorded;
+    for (size_t worker = 0; worker < mRecorded.size(); worker++)
+    {
+        if (mRecorded[worker])
+        {
+            recorded.push_back(*mCommandBuffers[frame][worker]);
+        }
+    }
+
+    if (cacheKey != nullptr)
+    {
+        mCacheKeys[frame] = *cacheKey;
+        mCachedBuffers[frame] = recorded;
+    }
+    return recorded;
+}
+
+void VulkanParallelRecorder::CreateWorkerPools(int worker, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice)
+{
+    for (size_t frame = 0; frame < mCommandPools.size(); frame++)
+    {
+        // Transient, the whole pool is reset with one call before the worker records into it again.
+        auto commandPool = std::make_shared<VulkanCommandPool>(surface, physicalDevice, mDevice, "ParallelRecorder" + std::to_string(frame) + "_" + std::to_string(worker), std::nullopt, true);
+        mCommandPools[frame][worker] = commandPool;
+        auto commandBuffer = commandPool->AcquireCommandBuffer(mDevice, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        // Neighbouring draws recorded by a worker usually share state.
+        commandBuffer->SetStateTracking(true);
+        mCommandBuffers[frame][worker] = commandBuffer;
+    }
+}
+
+void VulkanParallelRecorder::WorkerLoop(int worker, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice)
+{
+    CPU_PROFILE_THREAD_NAME("Recorder" + std::to_string(worker));
+    {
+        // Only this worker writes its own slots, the constructor reads them once every worker is done.
+        std::exception_ptr error = nullptr;
+        try
+        {
+            CreateWorkerPools(worker, surface, physicalDevice);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mJobMutex);
+            if (error != nullptr)
+            {
+                mJobError = error;
+            }
+            mPendingWorkers--;
+        }
+        mDoneCondition.notify_one();
+        if (error != nullptr) return;
+    }
+
+    uint64_t seenGeneration = 0;
+    while (true)
+    {
+        size_t frame;
+        VkRenderPass renderPass;
+        VkFramebuffer frameBuffer;
+        bool reusable;
+        size_t begin;
+        size_t end;
+        RecordFunction record;
+        {
+            std::unique_lock<std::mutex> lock(mJobMutex);
+            mJobCondition.wait(lock, [this, seenGeneration] { return mJobGeneration != seenGeneration || !mRunning; });
+            if (!mRunning) return;
+            seenGeneration = mJobGeneration;
+
+            // Contiguous ranges keep the draw order the same as single threaded recording.
+            size_t workerCount = mRecorded.size();
+            size_t rangeSize = (mJobItemCount + workerCount - 1) / workerCount;
+            frame = mJobFrame;
+            renderPass = mJobRenderPass;
+            frameBuffer = mJobFrameBuffer;
+            reusable = mJobReusable;
+            begin = std::min(worker * rangeSize, mJobItemCount);
+            end = std::min(begin + rangeSize, mJobItemCount);
+            record = mJobRecord;
+        }
+
+        std::exception_ptr error = nullptr;
+        if (begin < end)
+        {
+            CPU_PROFILE_ZONE("RecordSecondary");
+            try
+            {
+                // Only this worker uses the pool, and the frame's fence has been waited on.
+                auto commandPool = mCommandPools[frame][worker];
+                commandPool->Reset(mDevice);
+                auto commandBuffer = commandPool->AcquireCommandBuffer(mDevice, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+                mCommandBuffers[frame][worker] = commandBuffer;
+                commandBuffer->StartSecondaryCommandRecording(renderPass, 0, frameBuffer, reusable);
+                record(commandBuffer, begin, end);
+                commandBuffer->EndCommandRecording();
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mJobMutex);
+            mRecorded[worker] = begin < end && error == nullptr;
+            if (error != nullptr)
+            {
+                mJobError = error;
+            }
+            mPendingWorkers--;
+        }
+        mDoneCondition.notify_one();
+    }
+}
+
+void VulkanParallelRecorder::InvalidateCache()
+{
+    std::fill(mCacheKeys.begin(), mCacheKeys.end(), std::nullopt);
+}
+
+VulkanCommandStatistics VulkanParallelRecorder::Statistics() const
+{
+    VulkanCommandStatistics statistics;
+    if (mLastRecordReused) return statistics;
+    for (size_t worker = 0; worker < mRecorded.size(); worker++)
+    {
+        if (mRecorded[worker])
+        {
+            statistics.Issued += mCommandBuffers[mJobFrame][worker]->Statistics().Issued;
+            statistics.Elided += mCommandBuffers[mJobFrame][worker]->Statistics().Elided;
+        }
+    }
+    return statistics;
+}
+
+void VulkanParallelRecorder::CleanUp()
+{
+    {
+        std::lock_guard<std::mutex> lock(mJobMutex);
+        if (!mRunning) return;
+        mRunning = false;
+    }
+    mJobCondition.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+
+    for (auto& framePools : mCommandPools)
+    {
+        for (auto& commandPool : framePools)
+        {
+            // Null if its worker failed to create it.
+            if (commandPool == nullptr) continue;
+            commandPool->FreeCommandBuffers(mDevice);
+            commandPool->DestroyCommandPool(mDevice);
+        }
+    }
+    mCommandPools.clear();
+    mCommandBuffers.clear();
+}
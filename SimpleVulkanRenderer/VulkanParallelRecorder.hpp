@@ -0,0 +1,146 @@
+#pragma once
+#ifndef VULKAN_PARALLEL_RECORDER_H
+#define VULKAN_PARALLEL_RECORDER_H
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "VulkanIncludes.hpp"
+#include "VulkanCommandPool.hpp"
+#include "VulkanCommandBuffer.hpp"
+
+/// <summary>
+/// Identifies everything a reusable recording depends on.
+/// 
+/// Keys are compared by hash first and by their values only when the hashes match,
+/// so a hash collision can never hand out buffers recorded for something else.
+/// </summary>
+struct VulkanRecordingKey
+{
+	uint64_t Hash = 14695981039346656037ull;
+	std::vector<uint64_t> Values;
+
+	void Add(uint64_t value)
+	{
+		Values.push_back(value);
+		Hash = (Hash ^ value) * 1099511628211ull;
+		Hash ^= Hash >> 32;
+	}
+
+	/// <summary>
+	/// Start over, keeping the capacity of the values.
+	/// </summary>
+	void Clear()
+	{
+		Hash = 14695981039346656037ull;
+		Values.clear();
+	}
+
+	bool operator==(const VulkanRecordingKey& other) const
+	{
+		return Hash == other.Hash && Values == other.Values;
+	}
+};
+
+/// <summary>
+/// Records the draws of a render pass on several worker threads into secondary command buffers.
+/// 
+/// Every worker creates its own command pool per frame in flight on its thread, since command pools must not be used
+/// by two threads at once. The pools are transient and reset with a single call per recording. The work is split into contiguous ranges, one per worker, and the primary
+/// buffer executes the recorded secondaries in order.
+/// </summary>
+class VulkanParallelRecorder
+{
+public:
+	/// <summary>
+	/// Records the items [begin, end) into the secondary command buffer. Called on a worker thread.
+	/// </summary>
+	using RecordFunction = std::function<void(Ptr(VulkanCommandBuffer) commandBuffer, size_t begin, size_t end)>;
+
+	VulkanParallelRecorder(VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkDevice device, int framesInFlight, int workerCount);
+	~VulkanParallelRecorder();
+
+	/// <summary>
+	/// Split the items across the workers and record them, blocking until every worker has finished.
+	/// 
+	/// The fence of the frame must have been waited on, as its secondary command buffers are reset.
+	/// Errors thrown by the record function are rethrown here.
+	/// </summary>
+	/// <param name="cacheKey">
+	/// If given, the buffers are recorded to be reused. When the frame's buffers were last recorded with the same key
+	/// they are returned again without recording. The key must change whenever anything the record function
+	/// records changes. Reusable buffers are recorded without the framebuffer, so any swap chain image can use them.
+	/// </param>
+	/// <returns>The recorded secondary command buffers, to be executed inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.</returns>
+	std::vector<VkCommandBuffer> Record(size_t frame, VkRenderPass renderPass, VkFramebuffer frameBuffer, size_t itemCount, RecordFunction record, const VulkanRecordingKey* cacheKey = nullptr);
+
+	/// <summary>
+	/// Forget the cached buffers of every frame, so the next Record() of each records again.
+	/// </summary>
+	void InvalidateCache();
+
+	/// <summary>
+	/// The binds issued and elided over every secondary command buffer of the last Record(). Zero if it reused cached buffers.
+	/// </summary>
+	VulkanCommandStatistics Statistics() const;
+
+	/// <summary>
+	/// If the last Record() returned cached buffers instead of recording.
+	/// </summary>
+	bool LastRecordReused() const
+	{
+		return mLastRecordReused;
+	}
+
+	int WorkerCount() const
+	{
+		return static_cast<int>(mWorkers.size());
+	}
+
+	/// <summary>
+	/// Stop the worker threads and destroy the command pools. The device must be idle.
+	/// </summary>
+	void CleanUp();
+
+private:
+	void CreateWorkerPools(int worker, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice);
+	void WorkerLoop(int worker, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice);
+
+private:
+	VkDevice mDevice;
+
+	// Indexed by frame in flight, then by worker.
+	std::vector<std::vector<Ptr(VulkanCommandPool)>> mCommandPools;
+	std::vector<std::vector<Ptr(VulkanCommandBuffer)>> mCommandBuffers;
+
+	std::vector<std::thread> mWorkers;
+	std::mutex mJobMutex;
+	std::condition_variable mJobCondition;
+	std::condition_variable mDoneCondition;
+	bool mRunning;
+	// Bumped for every Record(), workers start when it changes.
+	uint64_t mJobGeneration;
+	int mPendingWorkers;
+
+	// The current job, only written while no worker is recording.
+	size_t mJobFrame;
+	VkRenderPass mJobRenderPass;
+	VkFramebuffer mJobFrameBuffer;
+	size_t mJobItemCount;
+	RecordFunction mJobRecord;
+	bool mJobReusable;
+	std::vector<bool> mRecorded;
+	std::exception_ptr mJobError;
+
+	// Indexed by frame in flight, the key and buffers of the last reusable recording.
+	std::vector<std::optional<VulkanRecordingKey>> mCacheKeys;
+	std::vector<std::vector<VkCommandBuffer>> mCachedBuffers;
+	bool mLastRecordReused;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include "VulkanPipelineCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    // "SVPC", marks a file written by VulkanPipelineCache.
+    constexpr uint32_t PIPELINE_CACHE_MAGIC = 0x43505653;
+}
+
+VulkanPipelineCache::VulkanPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, std::string path)
+    :
+    mDevice(device),
+    mPath(path),
+    mCache(VK_NULL_HANDLE),
+    mLoadedFromFile(false)
+{
+    vkGetPhysicalDeviceProperties(physicalDevice, &mProperties);
+
+    std::vector<char> initialData = LoadCacheData();
+    mLoadedFromFile = !initialData.empty();
+
+    VkPipelineCacheCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+
+    if (vkCreatePipelineCache(mDevice, &createInfo, nullptr, &mCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline cache!");
+    }
+}
+
+/// <summary>
+/// Read the cache data from the file, returns no data if the file is missing or was written by a different device or driver.
+/// </summary>
+std::vector<char> VulkanPipelineCache::LoadCacheData()
+{
+    if (mPath.empty()) return {};
+
+    std::ifstream file(mPath, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) return {};
+    std::streamoff fileSize = file.tellg();
+    file.seekg(0);
+
+    FileHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(FileHeader))) return {};
+
+    if (header.Magic != PIPELINE_CACHE_MAGIC ||
+        header.DriverVersion != mProperties.driverVersion ||
+        header.VendorID != mProperties.vendorID ||
+        header.DeviceID != mProperties.deviceID ||
+        memcmp(header.PipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        std::cout << "Pipeline cache " << mPath << " was written by a different device or driver, ignoring it." << std::endl;
+        return {};
+    }
+
+    // A truncated or corrupt file must not make us allocate whatever size its header claims.
+    if (header.DataSize < sizeof(VkPipelineCacheHeaderVersionOne) || header.DataSize != static_cast<uint64_t>(fileSize) - sizeof(FileHeader)) return {};
+
+    std::vector<char> data(header.DataSize);
+    if (!file.read(data.data(), data.size())) return {};
+
+    // The driver validates its own header as well, but a mismatch there would silently give an empty cache.
+    VkPipelineCacheHeaderVersionOne cacheHeader;
+    memcpy(&cacheHeader, data.data(), sizeof(VkPipelineCacheHeaderVersionOne));
+    if (cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+        cacheHeader.vendorID != mProperties.vendorID ||
+        cacheHeader.deviceID != mProperties.deviceID ||
+        memcmp(cacheHeader.pipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+    {
+        return {};
+    }
+
+    return data;
+}
+
+bool VulkanPipelineCache::Save()
+{
+    if (mPath.empty() || mCache == VK_NULL_HANDLE) return false;
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(mDevice, mCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) return false;
+
+    std::vector<char> data(dataSize);
+    if (vkGetPipelineCacheData(mDevice, mCache, &dataSize, data.data()) != VK_SUCCESS) return false;
+
+    FileHeader header{};
+    header.Magic = PIPELINE_CACHE_MAGIC;
+    header.DriverVersion = mProperties.driverVersion;
+    header.VendorID = mProperties.vendorID;
+    header.DeviceID = mProperties.deviceID;
+    memcpy(header.PipelineCacheUUID, mProperties.pipelineCacheUUID, VK_UUID_SIZE);
+    header.DataSize = dataSize;
+
+    // Write to a temporary file first so a crash while saving never leaves a truncated cache behind.
+    std::string tempPath = mPath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+        file.write(data.data(), dataSize);
+        if (!file) return false;
+    }
+
+    std::remove(mPath.c_str());
+    return std::rename(tempPath.c_str(), mPath.c_str()) == 0;
+}
+
+void VulkanPipelineCache::DestroyCache()
+{
+    vkDestroyPipelineCache(mDevice, mCache, nullptr);
+    mCache = VK_NULL_HANDLE;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#ifndef VULKAN_PIPELINE_CACHE_H
+#define VULKAN_PIPELINE_CACHE_H
+
+#include <string>
+
+#include "VulkanIncludes.hpp"
+
+/// <summary>
+/// A VkPipelineCache that persists between runs of the program.
+/// 
+/// The cache data is loaded from a file on creation and written back with Save(). The file is only
+/// used if it was written for the same device (vendor, device ID and pipeline cache UUID) and driver
+/// version, otherwise an empty cache is created and the file is overwritten on the next save.
+/// 
+/// A single cache is meant to be shared by every pipeline created with the device.
+/// </summary>
+class VulkanPipelineCache
+{
+public:
+	/// <param name="path">The file to load from and save to. If empty, the cache is not persisted.</param>
+	VulkanPipelineCache(VkPhysicalDevice physicalDevice, VkDevice device, std::string path);
+
+	/// <summary>
+	/// Write the current cache data to the file. Failing to write is not fatal, the cache is simply cold next run.
+	/// </summary>
+	/// <returns>If the data was written.</returns>
+	bool Save();
+
+	void DestroyCache();
+
+	VkPipelineCache Cache() const
+	{
+		return mCache;
+	}
+
+	/// <summary>
+	/// If valid cache data was loaded from the file.
+	/// </summary>
+	bool LoadedFromFile() const
+	{
+		return mLoadedFromFile;
+	}
+
+private:
+	/// <summary>
+	/// Prefixed to the cache data in the file. The data itself starts with a VkPipelineCacheHeaderVersionOne,
+	/// but that does not include the driver version.
+	/// </summary>
+	struct FileHeader
+	{
+		uint32_t Magic;
+		uint32_t DriverVersion;
+		uint32_t VendorID;
+		uint32_t DeviceID;
+		uint8_t PipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t DataSize;
+	};
+
+	std::vector<char> LoadCacheData();
+
+private:
+	VkDevice mDevice;
+	VkPhysicalDeviceProperties mProperties;
+	std::string mPath;
+
+	VkPipelineCache mCache;
+	bool mLoadedFromFile;
+};
+
+#endif
@@ -0,0 +1,162 @@
+#include "VulkanPipelineCompiler.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+VulkanPipelineHandle::VulkanPipelineHandle(std::shared_future<Ptr(VulkanGraphicsPipeline)> future)
+    :
+    mFuture(future)
+{
+}
+
+bool VulkanPipelineHandle::Ready() const
+{
+    return mFuture.valid() && mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+Ptr(VulkanGraphicsPipeline) VulkanPipelineHandle::Get() const
+{
+    if (!Ready()) return nullptr;
+
+    try
+    {
+        return mFuture.get();
+    }
+    catch (const std::exception&)
+    {
+        return nullptr;
+    }
+}
+
+Ptr(VulkanGraphicsPipeline) VulkanPipelineHandle::Wait() const
+{
+    if (!mFuture.valid())
+    {
+        throw std::runtime_error("Pipeline handle does not refer to a pipeline!");
+    }
+    return mFuture.get();
+}
+
+Ptr(VulkanGraphicsPipeline) VulkanPipelineHandle::GetOr(Ptr(VulkanGraphicsPipeline) fallback) const
+{
+    auto pipeline = Get();
+    return pipeline != nullptr ? pipeline : fallback;
+}
+
+VulkanPipelineCompiler::VulkanPipelineCompiler(VkDevice device, VkPipelineCache pipelineCache, int threadCount)
+    :
+    mDevice(device),
+    mPipelineCache(pipelineCache),
+    mRunning(true)
+{
+    threadCount = std::max(threadCount, 1);
+    for (int i = 0; i < threadCount; i++)
+    {
+        mWorkers.emplace_back(&VulkanPipelineCompiler::WorkerLoop, this);
+    }
+}
+
+VulkanPipelineCompiler::~VulkanPipelineCompiler()
+{
+    Shutdown();
+}
+
+VulkanPipelineHandle VulkanPipelineCompiler::Request(const GraphicsPipelineDescriptor& descriptor, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout)
+{
+    PermutationKey key(descriptor.VertexShader.get(), descriptor.FragmentShader.get(), descriptor.PermutationKey, renderPass, descriptorSetLayout);
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        auto existing = mPermutations.find(key);
+        if (existing != mPermutations.end())
+        {
+            return existing->second;
+        }
+    }
+
+    // Constructing the pipeline validates the descriptor, so errors are thrown on the calling thread.
+    auto pipeline = std::make_shared<VulkanGraphicsPipeline>(descriptor);
+
+    std::packaged_task<Ptr(VulkanGraphicsPipeline)()> task([this, pipeline, renderPass, descriptorSetLayout]() {
+        pipeline->UpdatePipeline(mDevice, renderPass, descriptorSetLayout, mPipelineCache);
+
+        std::lock_guard<std::mutex> lock(mBuiltMutex);
+        mBuiltPipelines.push_back(pipeline);
+        return pipeline;
+    });
+    VulkanPipelineHandle handle(task.get_future().share());
+
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        if (!mRunning)
+        {
+            throw std::runtime_error("Pipeline compiler has been shut down!");
+        }
+        // Another thread may have requested the same permutation in the meantime.
+        auto existing = mPermutations.find(key);
+        if (existing != mPermutations.end())
+        {
+            return existing->second;
+        }
+        mPermutations[key] = handle;
+        mQueue.push_back(std::move(task));
+    }
+    mQueueCondition.notify_one();
+
+    return handle;
+}
+
+void VulkanPipelineCompiler::ForgetPermutations()
+{
+    std::lock_guard<std::mutex> lock(mQueueMutex);
+    mPermutations.clear();
+}
+
+void VulkanPipelineCompiler::WorkerLoop()
+{
+    CPU_PROFILE_THREAD_NAME("PipelineCompiler");
+    while (true)
+    {
+        std::packaged_task<Ptr(VulkanGraphicsPipeline)()> task;
+        {
+            std::unique_lock<std::mutex> lock(mQueueMutex);
+            mQueueCondition.wait(lock, [this] { return !mQueue.empty() || !mRunning; });
+            if (!mRunning) return;
+
+            task = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        // Exceptions are stored in the future and rethrown by VulkanPipelineHandle::Wait().
+        CPU_PROFILE_ZONE("CompilePipeline");
+        task();
+    }
+}
+
+void VulkanPipelineCompiler::Shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        if (!mRunning) return;
+        mRunning = false;
+        // Destroying the pending tasks breaks their promises, so waiting handles wake up with an error.
+        mQueue.clear();
+    }
+    mQueueCondition.notify_all();
+
+    for (auto& worker : mWorkers)
+    {
+        worker.join();
+    }
+    mWorkers.clear();
+}
+
+void VulkanPipelineCompiler::CleanupPipelines()
+{
+    std::lock_guard<std::mutex> lock(mBuiltMutex);
+    for (auto& pipeline : mBuiltPipelines)
+    {
+        pipeline->CleanupPipeline(mDevice);
+    }
+    mBuiltPipelines.clear();
+}
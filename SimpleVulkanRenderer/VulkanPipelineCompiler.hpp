@@ -0,0 +1,120 @@
+#pragma once
+#ifndef VULKAN_PIPELINE_COMPILER_H
+#define VULKAN_PIPELINE_COMPILER_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <tuple>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "VulkanIncludes.hpp"
+#include "VulkanGraphicsPipeline.hpp"
+
+/// <summary>
+/// A pipeline requested from the VulkanPipelineCompiler that may still be compiling.
+/// 
+/// Copies refer to the same pipeline.
+/// </summary>
+class VulkanPipelineHandle
+{
+public:
+	VulkanPipelineHandle() = default;
+	VulkanPipelineHandle(std::shared_future<Ptr(VulkanGraphicsPipeline)> future);
+
+	/// <summary>
+	/// If the pipeline has finished compiling (or failed to).
+	/// </summary>
+	bool Ready() const;
+
+	/// <summary>
+	/// Get the pipeline without blocking.
+	/// </summary>
+	/// <returns>The pipeline, or nullptr if it is not ready yet or failed to compile. Draws using it should be skipped.</returns>
+	Ptr(VulkanGraphicsPipeline) Get() const;
+
+	/// <summary>
+	/// Block until the pipeline is compiled.
+	/// 
+	/// Throws the error the compilation failed with.
+	/// </summary>
+	Ptr(VulkanGraphicsPipeline) Wait() const;
+
+	/// <summary>
+	/// Get the pipeline if it is ready, otherwise the fallback pipeline.
+	/// </summary>
+	Ptr(VulkanGraphicsPipeline) GetOr(Ptr(VulkanGraphicsPipeline) fallback) const;
+
+private:
+	std::shared_future<Ptr(VulkanGraphicsPipeline)> mFuture;
+};
+
+/// <summary>
+/// Compiles graphics pipelines on a pool of background threads.
+/// 
+/// Every pipeline is created with the shared pipeline cache, which the driver synchronizes internally.
+/// The compiler owns the pipelines it builds and destroys them in CleanupPipelines().
+/// 
+/// As with VulkanGraphicsPipeline::UpdatePipeline(), the shader modules of a descriptor are destroyed once its
+/// pipeline is created, so shader objects must not be shared between requests.
+/// </summary>
+class VulkanPipelineCompiler
+{
+public:
+	VulkanPipelineCompiler(VkDevice device, VkPipelineCache pipelineCache, int threadCount);
+	~VulkanPipelineCompiler();
+
+	/// <summary>
+	/// Queue a pipeline to be compiled in the background.
+	/// 
+	/// Requesting the same shaders with the same permutation key, render pass and descriptor set layout
+	/// returns the handle of the earlier request.
+	/// </summary>
+	/// <returns>A handle to the pipeline, which can be polled while drawing.</returns>
+	VulkanPipelineHandle Request(const GraphicsPipelineDescriptor& descriptor, VkRenderPass renderPass, VkDescriptorSetLayout descriptorSetLayout);
+
+	/// <summary>
+	/// Forget every requested permutation, so later requests compile again. Call after destroying a render pass
+	/// or descriptor set layout pipelines were requested with, a new one may get the same handle.
+	/// The pipelines already built stay alive until CleanupPipelines().
+	/// </summary>
+	void ForgetPermutations();
+
+	/// <summary>
+	/// Stop the worker threads once the pipeline being compiled by each is done.
+	/// Requests that were not started yet are dropped, their handles never become available.
+	/// </summary>
+	void Shutdown();
+
+	/// <summary>
+	/// Destroy every pipeline built by this compiler. Call after Shutdown() once the device is idle.
+	/// </summary>
+	void CleanupPipelines();
+
+private:
+	void WorkerLoop();
+
+private:
+	VkDevice mDevice;
+	VkPipelineCache mPipelineCache;
+
+	std::mutex mQueueMutex;
+	std::condition_variable mQueueCondition;
+	std::deque<std::packaged_task<Ptr(VulkanGraphicsPipeline)()>> mQueue;
+	bool mRunning;
+	std::vector<std::thread> mWorkers;
+
+	// Shaders, permutation key, render pass and descriptor set layout of every request, so each permutation is only compiled once.
+	// The pipeline layout is made from the descriptor set layout, and pipelines are always built for subpass 0.
+	using PermutationKey = std::tuple<VulkanShaderIntf*, VulkanShaderIntf*, uint64_t, VkRenderPass, VkDescriptorSetLayout>;
+	std::map<PermutationKey, VulkanPipelineHandle> mPermutations;
+
+	std::mutex mBuiltMutex;
+	std::vector<Ptr(VulkanGraphicsPipeline)> mBuiltPipelines;
+};
+
+#endif
@@ -70,7 +70,13 @@ namespace
 
             // Find one that supports presentation. (Can be different than the graphics queue)
             VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            if (surface != VK_NULL_HANDLE) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+            }
+            else {
+                // Headless: nothing is presented, so the graphics family stands in for presentation.
+                presentSupport = indices.graphicsFamily.has_value();
+            }
 
             if (presentSupport) {
                 indices.presentFamily = i;
@@ -93,11 +99,13 @@ namespace
     {
         QueueFamilyIndices indicies = FindQueueFamilies(device, surface);
 
-        bool extensionSupported = CheckDeviceExtensionSupport(device);
+        // Headless rendering does not need the swap chain extension.
+        bool headless = surface == VK_NULL_HANDLE;
+        bool extensionSupported = headless || CheckDeviceExtensionSupport(device);
 
         // Check is swap chain is adequate.
-        bool swapChainAdequate = false;
-        if (extensionSupported) {
+        bool swapChainAdequate = headless;
+        if (extensionSupported && !headless) {
             VulkanSwapChain::SwapChainSupportDetails swapChainSupport = VulkanSwapChain::QuerySwapChainSupport(device, surface);
             swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
         }
@@ -110,13 +118,19 @@ namespace
     }
 
     // Get the list of required extensions.
-    std::vector<const char*> getRequiredExtensions()
+    std::vector<const char*> getRequiredExtensions(bool headless)
     {
-        uint32_t glfwExtensionCount = 0;
-        const char** glfwExtensions;
-        glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        std::vector<const char*> extensions;
+
+        // The surface extensions are only needed when there is a window to present to.
+        if (!headless)
+        {
+            uint32_t glfwExtensionCount = 0;
+            const char** glfwExtensions;
+            glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-        std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+            extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+        }
 
         if (enableValidationLayers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -125,6 +139,34 @@ namespace
         return extensions;
     }
 
+    bool InstanceExtensionAvailable(const char* name)
+    {
+        uint32_t extensionCount;
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, name) == 0) return true;
+        }
+        return false;
+    }
+
+    bool DeviceExtensionAvailable(VkPhysicalDevice device, const char* name)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const auto& extension : availableExtensions) {
+            if (strcmp(extension.extensionName, name) == 0) return true;
+        }
+        return false;
+    }
+
     std::vector<float> QueuePriorities(VulkanQueueType type, std::vector<VulkanQueueDescriptor>& queueDescriptors)
     {
         std::vector<float> priorities;
@@ -175,7 +217,13 @@ void VulkanRenderer::CreateVulkanInstance(VulkanInstanceInfo instanceInfo)
     createInfo.pApplicationInfo = &appInfo;
 
     // Get the required extensions.
-    auto extensions = getRequiredExtensions();
+    auto extensions = getRequiredExtensions(mHeadless);
+    // Needed to query the memory budget of the device, see QueryMemoryBudget().
+    mMemoryProperties2Supported = InstanceExtensionAvailable(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    if (mMemoryProperties2Supported)
+    {
+        extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+    }
 
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
@@ -226,13 +274,24 @@ void VulkanRenderer::SetupDebugMessenger()
 
 void VulkanRenderer::AutoInitialize(VulkanAutoInitSettings settings, std::function<void(Ptr(VulkanDescriptorLayout))> descriptorLayoutBuilderStage, std::function<GraphicsPipelineDescriptor()> pipelineDescriptionStage, std::function<void()> loadingStage, std::function<void(Ptr(VulkanDescriptorSetBuilder))> descriptorSetCreationStage)
 {
-    CreateGLFWWindow(settings.WindowWidth, settings.WindowHeight, "Test Renderer Application");
+    mHeadless = settings.Headless;
+    if (mHeadless)
+    {
+        mHeadlessExtent = { static_cast<uint32_t>(settings.WindowWidth), static_cast<uint32_t>(settings.WindowHeight) };
+    }
+    else
+    {
+        CreateGLFWWindow(settings.WindowWidth, settings.WindowHeight, "Test Renderer Application");
+    }
     CreateVulkanInstance(settings.InstanceInfo);
     if (settings.SetupDebug)
     {
         SetupDebugMessenger();
     }
-    CreateGLFWSurface();
+    if (!mHeadless)
+    {
+        CreateGLFWSurface();
+    }
     SelectPhysicalDevice();
     CreateLogicalDevice(settings.CustomQueues);
     SetupSwapChain(settings.SwapChainDescriptor);
@@ -241,18 +300,33 @@ void VulkanRenderer::AutoInitialize(VulkanAutoInitSettings settings, std::functi
     descriptorLayoutBuilderStage(mDescriptorHandler);
     mDescriptorHandler->BuildLayout();
 
-    CreateGraphicsPipeline(pipelineDescriptionStage());
+    CreatePipelineCache(settings.PipelineCachePath);
+    CreatePipelineCompiler(settings.PipelineCompileThreads);
+    // The primary pipeline compiles while the loading stage runs.
+    auto primaryPipeline = RequestGraphicsPipeline(pipelineDescriptionStage());
     CreateDefaultCommandPool("DefaultCommandPool");
     CreateBufferUtilities();
+    CreateDeletionQueue();
 
     loadingStage();
 
-    mDescriptorHandler->CreateDescriptorPool(mSwapChain->FrameBuffers().size());
+    mGraphicsPipeline = primaryPipeline.Wait();
+
+    // Descriptor sets are per frame in flight, like the uniform buffers they point to.
+    mDescriptorHandler->CreateDescriptorPool(mSwapChain->FramesInFlight());
     auto descriptorSetBuilder = mDescriptorHandler->DescriptorSetBuilder();
     descriptorSetCreationStage(descriptorSetBuilder);
     descriptorSetBuilder->UpdateDescriptorSets();
 
     CreateDefaultRenderCommandBuffers();
+    if (settings.RecordingThreads > 0)
+    {
+        CreateParallelRecorder(settings.RecordingThreads);
+    }
+    if (settings.GpuProfiling)
+    {
+        CreateGpuProfiler();
+    }
 }
 
 /// <summary>
@@ -402,9 +476,22 @@ void VulkanRenderer::CreateLogicalDevice(std::vector<VulkanQueueDescriptor> queu
     createInfo.pQueueCreateInfos = finalQueueCreateInfos.data();
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(finalQueueCreateInfos.size());
     createInfo.pEnabledFeatures = &deviceFeatures;
-    // Enable extensions for the logical device
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    // Enable extensions for the logical device, the swap chain is not needed when headless.
+    std::vector<const char*> enabledExtensions;
+    if (!mHeadless)
+    {
+        enabledExtensions = deviceExtensions;
+    }
+    // Optional, without it the memory budget is estimated from the tracked allocations.
+    mMemoryBudgetSupported = mMemoryProperties2Supported && DeviceExtensionAvailable(mPhysicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    if (mMemoryBudgetSupported)
+    {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        mGetPhysicalDeviceMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2KHR)vkGetInstanceProcAddr(mInstance, "vkGetPhysicalDeviceMemoryProperties2KHR");
+        mMemoryBudgetSupported = mGetPhysicalDeviceMemoryProperties2 != nullptr;
+    }
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+    createInfo.ppEnabledExtensionNames = enabledExtensions.data();
 
     // Modern implementations will ignore these as device layers are deprecated.
     if (enableValidationLayers)
@@ -441,6 +528,48 @@ void VulkanRenderer::CreateLogicalDevice(std::vector<VulkanQueueDescriptor> queu
     }
 }
 
+std::vector<VulkanHeapBudget> VulkanRenderer::QueryMemoryBudget()
+{
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 memoryProperties2{};
+    memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties2.pNext = &budgetProperties;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    if (mMemoryBudgetSupported)
+    {
+        mGetPhysicalDeviceMemoryProperties2(mPhysicalDevice, &memoryProperties2);
+        memoryProperties = memoryProperties2.memoryProperties;
+    }
+    else
+    {
+        vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memoryProperties);
+    }
+
+    std::vector<VulkanHeapBudget> heaps;
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        VulkanHeapBudget heap{};
+        heap.Size = memoryProperties.memoryHeaps[i].size;
+        heap.DeviceLocal = (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+        heap.Reported = mMemoryBudgetSupported;
+        if (mMemoryBudgetSupported)
+        {
+            heap.Budget = budgetProperties.heapBudget[i];
+            heap.Usage = budgetProperties.heapUsage[i];
+        }
+        else
+        {
+            // Leave room for other processes and for memory this renderer does not track, such as images.
+            heap.Budget = heap.Size / 10 * 8;
+            heap.Usage = VulkanMemoryStats::HeapUsage(i);
+        }
+        heaps.push_back(heap);
+    }
+    return heaps;
+}
+
 /// <summary>
 /// Create the swap chain to use and the image views that go with it.
 /// </summary>
@@ -448,7 +577,14 @@ void VulkanRenderer::CreateLogicalDevice(std::vector<VulkanQueueDescriptor> queu
 void VulkanRenderer::SetupSwapChain(const SwapChainDescriptor descriptor)
 {
     mSwapChain = std::make_shared<VulkanSwapChain>(mDevice, descriptor);
-    mSwapChain->InitializeSwapChain(mWindow, mSurface, mPhysicalDevice);
+    if (mHeadless)
+    {
+        mSwapChain->InitializeOffscreen(mPhysicalDevice, mHeadlessExtent);
+    }
+    else
+    {
+        mSwapChain->InitializeSwapChain(mWindow, mSurface, mPhysicalDevice);
+    }
     CreateRenderPass();
     mSwapChain->CreateDepthImage(mPhysicalDevice);
     mSwapChain->CreateFrameBuffers(mRenderPass);
@@ -471,7 +607,8 @@ void VulkanRenderer::CreateRenderPass()
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     // The layout is for images to be presented in the swap chain.
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    // Offscreen images are left ready to be copied out instead.
+    colorAttachment.finalLayout = mHeadless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
     VkAttachmentReference colorAttachmentRef{};
     colorAttachmentRef.attachment = 0;
@@ -523,12 +660,51 @@ void VulkanRenderer::CreateRenderPass()
     }
 }
 
+/// <summary>
+/// Create the pipeline cache shared by every pipeline, loading the cache data saved by a previous run from the path.
+/// 
+/// Must be called before CreateGraphicsPipeline() for the primary pipeline to use it.
+/// </summary>
+void VulkanRenderer::CreatePipelineCache(std::string path)
+{
+    mPipelineCache = std::make_shared<VulkanPipelineCache>(mPhysicalDevice, mDevice, path);
+}
+
+/// <summary>
+/// Create the background pipeline compiler. Must be called after CreatePipelineCache() for it to use the cache.
+/// </summary>
+void VulkanRenderer::CreatePipelineCompiler(int threadCount)
+{
+    mPipelineCompiler = std::make_shared<VulkanPipelineCompiler>(mDevice, mPipelineCache != nullptr ? mPipelineCache->Cache() : VK_NULL_HANDLE, threadCount);
+}
+
+/// <summary>
+/// Create the recorder that records secondary command buffers on worker threads, with a command pool per worker per frame in flight.
+/// </summary>
+void VulkanRenderer::CreateParallelRecorder(int workerCount)
+{
+    mParallelRecorder = std::make_shared<VulkanParallelRecorder>(mSurface, mPhysicalDevice, mDevice, mSwapChain->FramesInFlight(), workerCount);
+}
+
+void VulkanRenderer::CreateGpuProfiler()
+{
+    // The profiler measures the frame command buffers, which go to the default graphics queue.
+    QueueFamilyIndices indices = FindQueueFamilies(mPhysicalDevice, mSurface);
+    mGpuProfiler = std::make_shared<VulkanGpuProfiler>(mPhysicalDevice, mDevice, indices.graphicsFamily.value(), mSwapChain->FramesInFlight());
+}
+
 void VulkanRenderer::CreateGraphicsPipeline(const GraphicsPipelineDescriptor& descriptor)
 {
     if (mGraphicsPipeline != nullptr)
     {
         throw std::runtime_error("Graphics Pipeline already exists!");
     }
+    if (mPipelineCompiler != nullptr)
+    {
+        // Built by the compiler so it is cleaned up with the rest of its pipelines.
+        mGraphicsPipeline = RequestGraphicsPipeline(descriptor).Wait();
+        return;
+    }
     mGraphicsPipeline = std::make_shared<VulkanGraphicsPipeline>(descriptor);
-    mGraphicsPipeline->UpdatePipeline(mDevice, mRenderPass, mDescriptorHandler->Layout());
+    mGraphicsPipeline->UpdatePipeline(mDevice, mRenderPass, mDescriptorHandler->Layout(), mPipelineCache != nullptr ? mPipelineCache->Cache() : VK_NULL_HANDLE);
 }
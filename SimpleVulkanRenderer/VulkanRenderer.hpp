@@ -36,11 +36,14 @@
 #include "VulkanCommandPool.hpp"
 #include "VulkanCommandBuffer.hpp"
 #include "VulkanBufferUtilities.hpp"
+#include "VulkanDeletionQueue.hpp"
+#include "VulkanPipelineCache.hpp"
+#include "VulkanPipelineCompiler.hpp"
+#include "VulkanParallelRecorder.hpp"
+#include "VulkanGpuProfiler.hpp"
+#include "VulkanMemoryStats.hpp"
 #include "VulkanPipelineHolderIntf.hpp"
 
-// The amount of frames the system should try to handle at once.
-const int MAX_FRAMES_IN_FLIGHT = 2;
-
 // Specifiy the validation layers.
 const std::vector<const char*> validationLayers = {
     "VK_LAYER_KHRONOS_validation"
@@ -74,6 +77,32 @@ struct VulkanAutoInitSettings
     bool SetupDebug;
     std::vector<VulkanQueueDescriptor> CustomQueues;
     SwapChainDescriptor SwapChainDescriptor;
+    /// <summary>
+    /// Render without a window into offscreen images of WindowWidth x WindowHeight.
+    /// 
+    /// No surface is created and nothing is presented, so this also runs on devices without
+    /// a display (such as lavapipe).
+    /// </summary>
+    bool Headless = false;
+    /// <summary>
+    /// The file the pipeline cache is loaded from at startup and saved to on cleanup.
+    /// Leave empty to not persist the cache.
+    /// </summary>
+    std::string PipelineCachePath = "pipeline_cache.bin";
+    /// <summary>
+    /// The number of background threads compiling pipelines.
+    /// The primary pipeline compiles on them while the loading stage runs.
+    /// </summary>
+    int PipelineCompileThreads = 2;
+    /// <summary>
+    /// The number of worker threads recording secondary command buffers, see ParallelRecorder().
+    /// Zero to record everything on the render thread.
+    /// </summary>
+    int RecordingThreads = 0;
+    /// <summary>
+    /// Create a GpuProfiler() to measure scopes of the frame command buffer with timestamp queries.
+    /// </summary>
+    bool GpuProfiling = true;
 };
 
 
@@ -112,11 +141,15 @@ public: // Public Member Variables
         These can be manually changed if desired as long as it is done during the proper initalization phase.
     
     */
-    GLFWwindow* mWindow;
+    GLFWwindow* mWindow = nullptr;
     VkInstance mInstance;
     VkDebugUtilsMessengerEXT mDebugMessenger;
-    // Native surface.
-    VkSurfaceKHR mSurface;
+    // Native surface. Null when headless.
+    VkSurfaceKHR mSurface = VK_NULL_HANDLE;
+    // If rendering offscreen without a window or surface.
+    bool mHeadless = false;
+    // The size of the offscreen images when headless.
+    VkExtent2D mHeadlessExtent;
     VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
     // Logical Device:
     VkDevice mDevice;
@@ -140,8 +173,25 @@ public: // Public Member Variables
     std::shared_ptr<VulkanSwapChain> mSwapChain;
     std::shared_ptr<VulkanDescriptorLayout> mDescriptorHandler;
     std::shared_ptr<VulkanBufferUtilities> mBufferUtilities;
+    // Destroys retired resources once the frames in flight are done with them.
+    std::shared_ptr<VulkanDeletionQueue> mDeletionQueue;
     // Manages allocation of Command Buffers.
     std::shared_ptr<VulkanCommandPool> mDefaultCommandPool;
+    // One transient pool per frame in flight, reset once when the frame starts. The frame command buffers come from these.
+    VulkanFrameObject<Ptr(VulkanCommandPool)> mFrameCommandPools;
+    VulkanFrameObject<Ptr(VulkanCommandBuffer)> mFrameCommandBuffers;
+    // Shared by every pipeline, persisted between runs.
+    std::shared_ptr<VulkanPipelineCache> mPipelineCache;
+    // Compiles pipelines in the background, owns the pipelines it creates.
+    std::shared_ptr<VulkanPipelineCompiler> mPipelineCompiler;
+    // Records secondary command buffers on worker threads. Null if not enabled.
+    std::shared_ptr<VulkanParallelRecorder> mParallelRecorder;
+    // Times scopes of the frame command buffers on the GPU. Null if not enabled.
+    std::shared_ptr<VulkanGpuProfiler> mGpuProfiler;
+    // If VK_KHR_get_physical_device_properties2 and VK_EXT_memory_budget are enabled.
+    bool mMemoryProperties2Supported = false;
+    bool mMemoryBudgetSupported = false;
+    PFN_vkGetPhysicalDeviceMemoryProperties2KHR mGetPhysicalDeviceMemoryProperties2 = nullptr;
 
 // ------------------------------------------------------------------------------------------------------------------
 public: // Public Methods
@@ -160,12 +210,16 @@ public: // Public Methods
     void CreateLogicalDevice(std::vector<VulkanQueueDescriptor> queues);
     void SetupSwapChain(const SwapChainDescriptor descriptor);
     void CreateRenderPass();
+    void CreatePipelineCache(std::string path);
+    void CreatePipelineCompiler(int threadCount);
+    void CreateParallelRecorder(int workerCount);
+    void CreateGpuProfiler();
     void CreateGraphicsPipeline(const GraphicsPipelineDescriptor& descriptor);
     void CreateDefaultCommandPool(std::string identifier) {
         mDefaultCommandPool = std::make_shared<VulkanCommandPool>(mSurface, mPhysicalDevice, mDevice, identifier);
     }
-    Ptr(VulkanCommandPool) CreateCommandPool(std::string identifier, VulkanQueue queue) {
-        return std::make_shared<VulkanCommandPool>(mSurface, mPhysicalDevice, mDevice, identifier, queue);
+    Ptr(VulkanCommandPool) CreateCommandPool(std::string identifier, VulkanQueue queue, bool transient = false) {
+        return std::make_shared<VulkanCommandPool>(mSurface, mPhysicalDevice, mDevice, identifier, queue, transient);
     }
     void SetupDebugMessenger();
 
@@ -194,21 +248,55 @@ public: // Public Methods
 
     /// <summary>
     /// Forward the start drawing command to the SwapChain.
+    /// 
+    /// If the swap chain is out of date it is recreated and the image acquired again,
+    /// so the extent and framebuffers should be read after this call.
     /// </summary>
     /// <returns>The image being drawn to.</returns>
     uint32_t StartFrameDrawing()
     {
-        return mSwapChain->StartFrameDrawing();
+        uint32_t currentImage = mSwapChain->StartFrameDrawing();
+        while (mSwapChain->OutOfDate())
+        {
+            RecreateSwapChain();
+            currentImage = mSwapChain->StartFrameDrawing();
+        }
+        // The fence of this frame has been waited on, so older retired resources can be destroyed
+        // and the frame's command buffers can all be reset at once.
+        mDeletionQueue->StartFrame();
+        auto frameCommandPool = mFrameCommandPools[mSwapChain->CurrentFrame()];
+        frameCommandPool->Reset(mDevice);
+        mFrameCommandBuffers[mSwapChain->CurrentFrame()] = frameCommandPool->AcquireCommandBuffer(mDevice);
+        return currentImage;
     }
 
     void EndFrameDrawing(uint32_t currentImage)
     {
-        mSwapChain->EndFrameDrawing(mDefaultGraphicsQueue, *(mDefaultCommandPool->CommandBuffers()[mSwapChain->CurrentFrame()]), mPresentQueue, framebufferResized, currentImage);
+        mSwapChain->EndFrameDrawing(mDefaultGraphicsQueue, *mFrameCommandBuffers[mSwapChain->CurrentFrame()], mPresentQueue, framebufferResized, currentImage);
+        mDeletionQueue->EndFrame();
+
+        if (mSwapChain->OutOfDate())
+        {
+            RecreateSwapChain();
+        }
     }
 
+    /// <summary>
+    /// The primary command buffer submitted by EndFrameDrawing(). It has already been reset by StartFrameDrawing().
+    /// </summary>
     Ptr(VulkanCommandBuffer) GetFrameCommandBuffer()
     {
-        return mDefaultCommandPool->CommandBuffers()[mSwapChain->CurrentFrame()];
+        return mFrameCommandBuffers[mSwapChain->CurrentFrame()];
+    }
+
+    /// <summary>
+    /// The transient command pool of the current frame, for command buffers that only live for this frame.
+    /// 
+    /// Buffers acquired from it are recycled when the frame starts again. Only use it on the rendering thread.
+    /// </summary>
+    Ptr(VulkanCommandPool) GetFrameCommandPool()
+    {
+        return mFrameCommandPools[mSwapChain->CurrentFrame()];
     }
 
     // ------------------------------------------------------------------------------------------------------------------
@@ -235,6 +323,63 @@ public: // Public Methods
         return mSwapChain;
     }
 
+    Ptr(VulkanDeletionQueue) DeletionQueue()
+    {
+        return mDeletionQueue;
+    }
+
+    /// <summary>
+    /// The pipeline cache to pass to any additional pipelines created with this renderer.
+    /// </summary>
+    Ptr(VulkanPipelineCache) PipelineCache()
+    {
+        return mPipelineCache;
+    }
+
+    Ptr(VulkanPipelineCompiler) PipelineCompiler()
+    {
+        return mPipelineCompiler;
+    }
+
+    /// <summary>
+    /// Records secondary command buffers on worker threads, or null if VulkanAutoInitSettings::RecordingThreads was zero.
+    /// </summary>
+    Ptr(VulkanParallelRecorder) ParallelRecorder()
+    {
+        return mParallelRecorder;
+    }
+
+    /// <summary>
+    /// Times scopes of the frame command buffer on the GPU, or null if VulkanAutoInitSettings::GpuProfiling was off.
+    /// </summary>
+    Ptr(VulkanGpuProfiler) GpuProfiler()
+    {
+        return mGpuProfiler;
+    }
+
+    /// <summary>
+    /// The size, budget and usage of every memory heap of the device.
+    /// 
+    /// Reported by the driver when VK_EXT_memory_budget is supported, otherwise the budget is most of the heap
+    /// and the usage only counts the buffers tracked by VulkanMemoryStats.
+    /// </summary>
+    std::vector<VulkanHeapBudget> QueryMemoryBudget();
+
+    bool MemoryBudgetSupported() const
+    {
+        return mMemoryBudgetSupported;
+    }
+
+    /// <summary>
+    /// Compile a pipeline for the default render pass and descriptor layout in the background.
+    /// 
+    /// Until the handle is ready, draws can use PrimaryGraphicsPipeline() as the fallback or be skipped.
+    /// </summary>
+    VulkanPipelineHandle RequestGraphicsPipeline(const GraphicsPipelineDescriptor& descriptor)
+    {
+        return mPipelineCompiler->Request(descriptor, mRenderPass, mDescriptorHandler->Layout());
+    }
+
     VkQueue GetNamedQueue(std::string name)
     {
         return mQueueMap[name].queue;
@@ -252,23 +397,26 @@ public: // Public Methods
     // Cleanup the swap chain.
     void cleanupSwapChain() {
 
-        vkDestroyImageView(mDevice, mSwapChain->DepthImageView(), nullptr);
-        vkDestroyImage(mDevice, mSwapChain->DepthImage(), nullptr);
-        vkFreeMemory(mDevice, mSwapChain->DepthImageMemory(), nullptr);
-
-        for (auto framebuffer : mSwapChain->FrameBuffers()) {
-            vkDestroyFramebuffer(mDevice, framebuffer, nullptr);
-        }
+        mSwapChain->DestroyImageResources();
 
         mDefaultCommandPool->FreeCommandBuffers(mDevice);
-
-        // Destroy the image views.
-        for (auto imageView : mSwapChain->ImageViews()) {
-            vkDestroyImageView(mDevice, imageView, nullptr);
+        for (auto& commandPool : mFrameCommandPools.InternalVector()) {
+            commandPool->FreeCommandBuffers(mDevice);
         }
 
-        // Destroy the swap chain.
-        vkDestroySwapchainKHR(mDevice, mSwapChain->SwapChain(), nullptr);
+        if (mSwapChain->Headless())
+        {
+            // The offscreen images are owned by the renderer, unlike swap chain images.
+            for (size_t i = 0; i < mSwapChain->Images().size(); i++) {
+                vkDestroyImage(mDevice, mSwapChain->Images()[i], nullptr);
+                vkFreeMemory(mDevice, mSwapChain->OffscreenImageMemory()[i], nullptr);
+            }
+        }
+        else
+        {
+            // Destroy the swap chain.
+            vkDestroySwapchainKHR(mDevice, mSwapChain->SwapChain(), nullptr);
+        }
 
         vkDestroyDescriptorPool(mDevice, mDescriptorHandler->BuiltDescriptorPool(), nullptr);
     }
@@ -277,7 +425,18 @@ public: // Public Methods
 
         cleanupSwapChain();
 
-        mGraphicsPipeline->CleanupPipeline(mDevice);
+        if (mPipelineCompiler != nullptr) {
+            // The compiler owns the pipelines it built, including the primary one.
+            mPipelineCompiler->Shutdown();
+            mPipelineCompiler->CleanupPipelines();
+        }
+        else {
+            mGraphicsPipeline->CleanupPipeline(mDevice);
+        }
+        if (mPipelineCache != nullptr) {
+            mPipelineCache->Save();
+            mPipelineCache->DestroyCache();
+        }
         vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
 
         vkDestroyDescriptorSetLayout(mDevice, mDescriptorHandler->Layout(), nullptr);
@@ -288,6 +447,19 @@ public: // Public Methods
         mSwapChain->CleanUp();
 
         mDefaultCommandPool->DestroyCommandPool(mDevice);
+        for (auto& commandPool : mFrameCommandPools.InternalVector()) {
+            commandPool->DestroyCommandPool(mDevice);
+        }
+
+        if (mParallelRecorder != nullptr) {
+            mParallelRecorder->CleanUp();
+        }
+
+        if (mGpuProfiler != nullptr) {
+            mGpuProfiler->DestroyQueryPools();
+        }
+
+        mDeletionQueue->Flush();
 
         // Destroy the device.
         vkDestroyDevice(mDevice, nullptr);
@@ -296,12 +468,16 @@ public: // Public Methods
             DestroyDebugUtilsMessengerEXT(mInstance, mDebugMessenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+        if (mSurface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+        }
         vkDestroyInstance(mInstance, nullptr);
 
         // Destroy and terminate the window.
-        glfwDestroyWindow(mWindow);
-        glfwTerminate();
+        if (mWindow != nullptr) {
+            glfwDestroyWindow(mWindow);
+            glfwTerminate();
+        }
     }
 
     bool checkValidationLayerSupport() {
@@ -334,34 +510,44 @@ public: // Public Methods
         mBufferUtilities = std::make_shared<VulkanBufferUtilities>(mPhysicalDevice, mDevice, mDefaultCommandPool->CommandPool(), mDefaultGraphicsQueue);
     }
 
-    // Recreate the swap chain when needed (like on window resize).
-    void recreateSwapChain() {
-        /*int width = 0, height = 0;
-        glfwGetFramebufferSize(window, &width, &height);
+    void CreateDeletionQueue()
+    {
+        mDeletionQueue = std::make_shared<VulkanDeletionQueue>(mDevice, mSwapChain->FramesInFlight());
+    }
+
+    /// <summary>
+    /// Recreate the swap chain when needed (like on window resize).
+    /// 
+    /// Only the swap chain images, depth image and framebuffers are rebuilt. The pipelines use a dynamic
+    /// viewport and scissor, so they, the descriptor sets, command buffers and chunk buffers are all kept.
+    /// Only the frames in flight and the present queue are waited on rather than the whole device.
+    /// </summary>
+    void RecreateSwapChain() {
+        if (mSwapChain->Headless()) {
+            return;
+        }
+
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(mWindow, &width, &height);
         // This code handles minimization. Wait until the program is unminimized.
         while (width == 0 || height == 0) {
-            glfwGetFramebufferSize(window, &width, &height);
+            glfwGetFramebufferSize(mWindow, &width, &height);
             glfwWaitEvents();
         }
 
-        // Wait until all device resources are not in use.
-        vkDeviceWaitIdle(device);
-
-        cleanupSwapChain();
-        mSwapChain->InitializeSwapChain(window, surface, physicalDevice, device);
-        mSwapChain->CreateDepthImage(physicalDevice, device);
-        mSwapChain->CreateFrameBuffers(device, renderPass);
-        CreateUniformBuffers();
-        CreateDefaultRenderCommandBuffers(nullptr, nullptr, 0); // TODO:: Fix
-        */
+        mSwapChain->RecreateSwapChain(mWindow, mSurface, mPhysicalDevice, mRenderPass, mPresentQueue);
     }
 
     // Create objects needed for syncronization.
     //void CreateSyncObjects();
 
+    // One transient pool and command buffer per frame in flight, GetFrameCommandBuffer() picks the one of the current frame.
     void CreateDefaultRenderCommandBuffers() {
-        for (size_t i = 0; i < mSwapChain->FrameBuffers().size(); i++) {
-            auto commandBuffer = mDefaultCommandPool->CreateCommandBuffer(mDevice);
+        mFrameCommandPools = VulkanFrameObject<Ptr(VulkanCommandPool)>(mSwapChain->FramesInFlight());
+        mFrameCommandBuffers = VulkanFrameObject<Ptr(VulkanCommandBuffer)>(mSwapChain->FramesInFlight());
+        for (size_t i = 0; i < mSwapChain->FramesInFlight(); i++) {
+            mFrameCommandPools[i] = std::make_shared<VulkanCommandPool>(mSurface, mPhysicalDevice, mDevice, "FrameCommandPool" + std::to_string(i), std::nullopt, true);
+            mFrameCommandBuffers[i] = mFrameCommandPools[i]->AcquireCommandBuffer(mDevice);
         }
     }
 // ------------------------------------------------------------------------------------------------------------------
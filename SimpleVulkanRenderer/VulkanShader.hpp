@@ -2,13 +2,79 @@
 #ifndef VULKAN_SHADER_H
 #define VULKAN_SHADER_H
 
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
 #include "VulkanIncludes.hpp"
 
+/// <summary>
+/// The values of the specialization constants (layout(constant_id = N) const ...) of a shader stage.
+/// 
+/// Features toggled with specialization constants are compiled out of a pipeline instead of branched on at runtime.
+/// </summary>
+class VulkanSpecializationConstants
+{
+public:
+	/// <summary>
+	/// Set the value of a constant. Booleans must be passed as VkBool32 to match the 4 byte size of a GLSL bool.
+	/// </summary>
+	template<typename T>
+	void Set(uint32_t constantID, const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Specialization constants must be trivially copyable!");
+
+		for (auto& entry : mEntries)
+		{
+			if (entry.constantID == constantID && entry.size == sizeof(T))
+			{
+				memcpy(mData.data() + entry.offset, &value, sizeof(T));
+				return;
+			}
+		}
+
+		VkSpecializationMapEntry entry{};
+		entry.constantID = constantID;
+		entry.offset = static_cast<uint32_t>(mData.size());
+		entry.size = sizeof(T);
+		mEntries.push_back(entry);
+
+		mData.resize(mData.size() + sizeof(T));
+		memcpy(mData.data() + entry.offset, &value, sizeof(T));
+	}
+
+	bool Empty() const
+	{
+		return mEntries.empty();
+	}
+
+	/// <summary>
+	/// Get the specialization info. It points into this object, so it is only valid while this is alive and unchanged.
+	/// </summary>
+	VkSpecializationInfo Info() const
+	{
+		VkSpecializationInfo info{};
+		info.mapEntryCount = static_cast<uint32_t>(mEntries.size());
+		info.pMapEntries = mEntries.data();
+		info.dataSize = mData.size();
+		info.pData = mData.data();
+		return info;
+	}
+
+private:
+	std::vector<VkSpecializationMapEntry> mEntries;
+	std::vector<uint8_t> mData;
+};
+
 class VulkanShaderIntf {
 public:
 	~VulkanShaderIntf() = default;
 
-	virtual VkPipelineShaderStageCreateInfo GetShaderStage() = 0;
+	/// <summary>
+	/// Get the shader stage, optionally specialized with the given constants.
+	/// </summary>
+	/// <param name="specializationInfo">The specialization constants, must stay valid until the pipeline is created.</param>
+	virtual VkPipelineShaderStageCreateInfo GetShaderStage(const VkSpecializationInfo* specializationInfo = nullptr) = 0;
 
 	/// <summary>
 	/// Destroy the shader module if needed.
@@ -0,0 +1,98 @@
+#include "VulkanStagingMeshSink.hpp"
+#include "CpuProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr VkDeviceSize QUAD_VERTEX_BYTES = 4 * sizeof(Vertex);
+    constexpr VkDeviceSize QUAD_INDEX_BYTES = 6 * sizeof(uint32_t);
+}
+
+VulkanStagingMeshSink::VulkanStagingMeshSink(Ptr(VulkanBufferUtilities) bufferUtils)
+    :
+    mBufferUtils(bufferUtils),
+    mCapacity(0),
+    mStagedQuads(0)
+{
+}
+
+VulkanStagingMeshSink::~VulkanStagingMeshSink()
+{
+    DestroyStagingBuffer();
+}
+
+void VulkanStagingMeshSink::Begin(size_t estimatedQuads)
+{
+    // Grow to fit the last mesh, so a spill is not repeated the next time the same chunk is meshed.
+    size_t neededQuads = std::max(estimatedQuads, QuadCount());
+    mStagedQuads = 0;
+    mSpill.verticies.clear();
+    mSpill.indicies.clear();
+
+    if (neededQuads <= mCapacity) return;
+
+    DestroyStagingBuffer();
+    mStagingBuffer = mBufferUtils->CreateStagingBuffer(neededQuads * (QUAD_VERTEX_BYTES + QUAD_INDEX_BYTES));
+    mCapacity = neededQuads;
+}
+
+void VulkanStagingMeshSink::AddQuad(const Vertex* vertices, const uint32_t* indices)
+{
+    if (mStagedQuads == mCapacity)
+    {
+        mSpill.AddQuad(vertices, indices);
+        return;
+    }
+
+    // Only ever written, never read, the memory may be write combined.
+    char* staging = static_cast<char*>(mStagingBuffer.MappedMemory());
+    memcpy(staging + mStagedQuads * QUAD_VERTEX_BYTES, vertices, QUAD_VERTEX_BYTES);
+    memcpy(staging + mCapacity * QUAD_VERTEX_BYTES + mStagedQuads * QUAD_INDEX_BYTES, indices, QUAD_INDEX_BYTES);
+    mStagedQuads++;
+}
+
+void VulkanStagingMeshSink::Upload(VulkanBuffer& outVertexBuffer, VulkanBuffer& outIndexBuffer, Ptr(VulkanCommandPool) commandPool, VkQueue queue)
+{
+    size_t quadCount = QuadCount();
+    if (quadCount == 0) return;
+
+    mBufferUtils->CreateBuffer(quadCount * QUAD_VERTEX_BYTES, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, outVertexBuffer, outVertexBuffer);
+    mBufferUtils->CreateBuffer(quadCount * QUAD_INDEX_BYTES, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, outIndexBuffer, outIndexBuffer);
+
+    std::vector<VulkanBufferCopy> copies;
+    if (mStagedQuads != 0)
+    {
+        copies.push_back({ mStagingBuffer, outVertexBuffer, { 0, 0, mStagedQuads * QUAD_VERTEX_BYTES } });
+        copies.push_back({ mStagingBuffer, outIndexBuffer, { mCapacity * QUAD_VERTEX_BYTES, 0, mStagedQuads * QUAD_INDEX_BYTES } });
+    }
+
+    // The spilled quads follow the staged ones in both buffers.
+    size_t spilledQuads = quadCount - mStagedQuads;
+    VulkanMappedBuffer spillBuffer;
+    if (spilledQuads != 0)
+    {
+        CPU_PROFILE_ZONE("StagingSpill");
+        VkDeviceSize vertexBytes = spilledQuads * QUAD_VERTEX_BYTES;
+        VkDeviceSize indexBytes = spilledQuads * QUAD_INDEX_BYTES;
+        spillBuffer = mBufferUtils->CreateStagingBuffer(vertexBytes + indexBytes);
+        char* staging = static_cast<char*>(spillBuffer.MappedMemory());
+        memcpy(staging, mSpill.verticies.data(), (size_t)vertexBytes);
+        memcpy(staging + vertexBytes, mSpill.indicies.data(), (size_t)indexBytes);
+
+        copies.push_back({ spillBuffer, outVertexBuffer, { 0, mStagedQuads * QUAD_VERTEX_BYTES, vertexBytes } });
+        copies.push_back({ spillBuffer, outIndexBuffer, { vertexBytes, mStagedQuads * QUAD_INDEX_BYTES, indexBytes } });
+    }
+
+    mBufferUtils->CopyBuffers(copies, commandPool, queue);
+    mBufferUtils->DestroyStagingBuffer(spillBuffer);
+}
+
+void VulkanStagingMeshSink::DestroyStagingBuffer()
+{
+    mBufferUtils->DestroyStagingBuffer(mStagingBuffer);
+    mCapacity = 0;
+    mStagedQuads = 0;
+    mSpill = AlgorithmOutput();
+}
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef VULKAN_STAGING_MESH_SINK_H
+#define VULKAN_STAGING_MESH_SINK_H
+
+#include "VulkanIncludes.hpp"
+#include "VulkanBufferUtilities.hpp"
+#include "MeshSink.hpp"
+
+/// <summary>
+/// A mesh sink that writes quads straight into mapped staging memory, so meshing and uploading copy nothing on the CPU.
+///
+/// The staging buffer holds the vertices of its capacity followed by their indices. Quads past the capacity spill into
+/// vectors and go through a second staging buffer, since reading back the mapped memory to grow it would be slow.
+/// Once a mesh spilled, the next Begin() grows the staging buffer to fit it.
+/// </summary>
+class VulkanStagingMeshSink : public MeshSink
+{
+public:
+	VulkanStagingMeshSink(Ptr(VulkanBufferUtilities) bufferUtils);
+	~VulkanStagingMeshSink();
+
+	VulkanStagingMeshSink(const VulkanStagingMeshSink&) = delete;
+	VulkanStagingMeshSink& operator=(const VulkanStagingMeshSink&) = delete;
+
+	/// <summary>
+	/// Start a new mesh, making room for at least the estimated number of quads.
+	/// </summary>
+	void Begin(size_t estimatedQuads);
+
+	void AddQuad(const Vertex* vertices, const uint32_t* indices) override;
+
+	/// <summary>
+	/// Create the device local vertex and index buffers of the mesh and copy it into them.
+	///
+	/// Waits for the copy, after which the sink can begin the next mesh. Does nothing for an empty mesh.
+	/// </summary>
+	void Upload(VulkanBuffer& outVertexBuffer, VulkanBuffer& outIndexBuffer, Ptr(VulkanCommandPool) commandPool = nullptr, VkQueue queue = nullptr);
+
+	size_t QuadCount() const
+	{
+		return mStagedQuads + mSpill.indicies.size() / 6;
+	}
+
+	uint32_t IndexCount() const
+	{
+		return static_cast<uint32_t>(QuadCount() * 6);
+	}
+
+	/// <summary>
+	/// The bytes of the device local buffers of the mesh.
+	/// </summary>
+	size_t MeshBytes() const
+	{
+		return QuadCount() * (4 * sizeof(Vertex) + 6 * sizeof(uint32_t));
+	}
+
+	/// <summary>
+	/// The CPU bytes held by the quads that did not fit into staging memory.
+	/// </summary>
+	size_t SpillBytes() const
+	{
+		return mSpill.verticies.capacity() * sizeof(Vertex) + mSpill.indicies.capacity() * sizeof(uint32_t);
+	}
+
+	/// <summary>
+	/// Release the staging buffer and any spilled quads. The next Begin() creates a new staging buffer.
+	/// </summary>
+	void DestroyStagingBuffer();
+
+private:
+	Ptr(VulkanBufferUtilities) mBufferUtils;
+	VulkanMappedBuffer mStagingBuffer;
+	// In quads.
+	size_t mCapacity;
+	size_t mStagedQuads;
+	AlgorithmOutput mSpill;
+};
+
+#endif
@@ -1,6 +1,7 @@
 #include "VulkanSwapChain.hpp"
 #include "VulkanRendererTypes.hpp"
 #include "VulkanImageUtilities.hpp"
+#include "CpuProfiler.hpp"
 
 #include <stdexcept>
 #include <array>
@@ -68,7 +69,11 @@ VulkanSwapChain::VulkanSwapChain(VkDevice device, const SwapChainDescriptor desc
 	: 
     mDevice(device),
     mDescriptor(descriptor),
-    mCurrentFrame(0)
+    mSwapChain(VK_NULL_HANDLE),
+    mHeadless(false),
+    mCurrentFrame(0),
+    mCurrentImageIndex(0),
+    mOutOfDate(false)
 {
 }
 
@@ -86,9 +91,7 @@ void VulkanSwapChain::InitializeSwapChain(GLFWwindow* window, VkSurfaceKHR surfa
     {
         imageCount = swapChainSupport.capabilities.maxImageCount;
     }
-    
-    //TODO:: Override image count to always be 2 until I fix the hard-coded dependencies
-    imageCount = 2;
+
 
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -126,7 +129,9 @@ void VulkanSwapChain::InitializeSwapChain(GLFWwindow* window, VkSurfaceKHR surfa
     createInfo.presentMode = presentMode;
     // We don't care about the color of the pixels that are obscured.
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    // When recreating, the old swap chain lets the driver hand over resources and images still being presented.
+    VkSwapchainKHR oldSwapChain = mSwapChain;
+    createInfo.oldSwapchain = oldSwapChain;
 
     // Create it using the device, swap chain info, and the place to store the swap chain.
     if (vkCreateSwapchainKHR(mDevice, &createInfo, nullptr, &mSwapChain) != VK_SUCCESS)
@@ -134,6 +139,11 @@ void VulkanSwapChain::InitializeSwapChain(GLFWwindow* window, VkSurfaceKHR surfa
         throw std::runtime_error("Failed to create valid swap chain!");
     }
 
+    if (oldSwapChain != VK_NULL_HANDLE)
+    {
+        vkDestroySwapchainKHR(mDevice, oldSwapChain, nullptr);
+    }
+
     vkGetSwapchainImagesKHR(mDevice, mSwapChain, &imageCount, nullptr);
     mSwapChainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(mDevice, mSwapChain, &imageCount, mSwapChainImages.data());
@@ -144,6 +154,27 @@ void VulkanSwapChain::InitializeSwapChain(GLFWwindow* window, VkSurfaceKHR surfa
     CreateImageViews();
 }
 
+void VulkanSwapChain::InitializeOffscreen(VkPhysicalDevice physicalDevice, VkExtent2D extent)
+{
+    mHeadless = true;
+    mSwapChainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+    mSwapChainExtent = extent;
+
+    uint32_t imageCount = mDescriptor.ImageCount ? *mDescriptor.ImageCount : mDescriptor.FramesInFlight;
+
+    mSwapChainImages.resize(imageCount);
+    mOffscreenImageMemory.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++)
+    {
+        // Transfer source so frames can be read back.
+        CreateImage(physicalDevice, mDevice, extent.width, extent.height, mSwapChainImageFormat, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            mSwapChainImages[i], mOffscreenImageMemory[i]);
+    }
+
+    CreateImageViews();
+}
+
 void VulkanSwapChain::CreateDepthImage(VkPhysicalDevice physicalDevice)
 {
     VkFormat depthFormat = FindDepthFormat(physicalDevice);
@@ -182,10 +213,9 @@ void VulkanSwapChain::CreateFrameBuffers(VkRenderPass renderPass)
 
 void VulkanSwapChain::CreateSyncObjects()
 {
-    // TODO:: Replace with max frames in flight.
-    mImageAvailableSemaphore = VulkanFrameObject<VkSemaphore>(2);
-    mRenderFinishedSemaphore = VulkanFrameObject<VkSemaphore>(2);
-    mInFlightFence = VulkanFrameObject<VkFence>(2);
+    mImageAvailableSemaphore = VulkanFrameObject<VkSemaphore>(mDescriptor.FramesInFlight);
+    mRenderFinishedSemaphore = VulkanFrameObject<VkSemaphore>(mDescriptor.FramesInFlight);
+    mInFlightFence = VulkanFrameObject<VkFence>(mDescriptor.FramesInFlight);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -194,7 +224,7 @@ void VulkanSwapChain::CreateSyncObjects()
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < 2; i++)
+    for (size_t i = 0; i < mDescriptor.FramesInFlight; i++)
     {
         if (vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mImageAvailableSemaphore[i]) != VK_SUCCESS ||
             vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &mRenderFinishedSemaphore[i]) != VK_SUCCESS ||
@@ -207,13 +237,29 @@ void VulkanSwapChain::CreateSyncObjects()
 
 uint32_t VulkanSwapChain::StartFrameDrawing()
 {
-    vkWaitForFences(mDevice, 1, &mInFlightFence[mCurrentFrame], VK_TRUE, UINT64_MAX); // Ensure the frame is available and not being processed by the GPU.
+    {
+        CPU_PROFILE_ZONE("WaitForFrame");
+        vkWaitForFences(mDevice, 1, &mInFlightFence[mCurrentFrame], VK_TRUE, UINT64_MAX); // Ensure the frame is available and not being processed by the GPU.
+    }
+
+    if (mHeadless)
+    {
+        // There is nothing to acquire from, just cycle through the offscreen images.
+        uint32_t imageIndex = mCurrentImageIndex;
+        mCurrentImageIndex = (mCurrentImageIndex + 1) % mSwapChainImages.size();
+        vkResetFences(mDevice, 1, &mInFlightFence[mCurrentFrame]);
+        return imageIndex;
+    }
+
     uint32_t imageIndex;
 
+    CPU_PROFILE_ZONE("AcquireImage");
     VkResult result = vkAcquireNextImageKHR(mDevice, mSwapChain, UINT64_MAX, mImageAvailableSemaphore[mCurrentFrame], VK_NULL_HANDLE, &imageIndex);
     if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
-        // TODO: Figure out what to do about this.
+        // The fence is left signaled so the frame can be started again once the swap chain is recreated.
+        mOutOfDate = true;
+        return imageIndex;
     }
     else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
     {
@@ -232,7 +278,8 @@ void VulkanSwapChain::EndFrameDrawing(VkQueue graphicsQueue, VkCommandBuffer com
 
     VkSemaphore waitSemaphores[] = { mImageAvailableSemaphore[mCurrentFrame] };
     VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-    submitInfo.waitSemaphoreCount = 1;
+    // Offscreen images are not acquired or presented, so there is nothing to wait on or signal.
+    submitInfo.waitSemaphoreCount = mHeadless ? 0 : 1;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
@@ -240,12 +287,21 @@ void VulkanSwapChain::EndFrameDrawing(VkQueue graphicsQueue, VkCommandBuffer com
     submitInfo.pCommandBuffers = &commandBuffer;
 
     VkSemaphore signalSemaphores[] = { mRenderFinishedSemaphore[mCurrentFrame] };
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = mHeadless ? 0 : 1;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, mInFlightFence[mCurrentFrame]) != VK_SUCCESS)
     {
-        throw std::runtime_error("Failed to submit draw command buffer.");
+        CPU_PROFILE_ZONE("Submit");
+        if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, mInFlightFence[mCurrentFrame]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to submit draw command buffer.");
+        }
+    }
+
+    if (mHeadless)
+    {
+        mCurrentFrame = (mCurrentFrame + 1) % mDescriptor.FramesInFlight;
+        return;
     }
 
     VkPresentInfoKHR presentInfo{};
@@ -260,25 +316,63 @@ void VulkanSwapChain::EndFrameDrawing(VkQueue graphicsQueue, VkCommandBuffer com
 
     presentInfo.pImageIndices = &imageIndex;
 
+    CPU_PROFILE_ZONE("Present");
     VkResult result = vkQueuePresentKHR(presentationQueue, &presentInfo);
 
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized) {
         framebufferResized = false;
-        //recreateSwapChain();
-        // TODO: Create swap chain.
+        mOutOfDate = true;
     }
     else if (result != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to present swap chain image.");
     }
 
-    // TODO:: Update this "2" to be max frames in flight.
-    mCurrentFrame = (mCurrentFrame + 1) % 2;
+    mCurrentFrame = (mCurrentFrame + 1) % mDescriptor.FramesInFlight;
+}
+
+void VulkanSwapChain::WaitForFramesInFlight()
+{
+    vkWaitForFences(mDevice, static_cast<uint32_t>(mInFlightFence.InternalVector().size()), mInFlightFence.InternalVector().data(), VK_TRUE, UINT64_MAX);
+}
+
+void VulkanSwapChain::DestroyImageResources()
+{
+    for (auto framebuffer : mSwapChainFrameBuffers)
+    {
+        vkDestroyFramebuffer(mDevice, framebuffer, nullptr);
+    }
+    mSwapChainFrameBuffers.clear();
+
+    vkDestroyImageView(mDevice, mDepthImageView, nullptr);
+    vkDestroyImage(mDevice, mDepthImage, nullptr);
+    vkFreeMemory(mDevice, mDepthImageMemory, nullptr);
+
+    for (auto imageView : mSwapChainImageViews)
+    {
+        vkDestroyImageView(mDevice, imageView, nullptr);
+    }
+    mSwapChainImageViews.clear();
+}
+
+void VulkanSwapChain::RecreateSwapChain(GLFWwindow* window, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkRenderPass renderPass, VkQueue presentQueue)
+{
+    // The framebuffers and depth image may still be used by frames in flight.
+    WaitForFramesInFlight();
+    // The fences don't cover presentation, the old swap chain's images and semaphores may still be in use by a present.
+    vkQueueWaitIdle(presentQueue);
+
+    DestroyImageResources();
+    InitializeSwapChain(window, surface, physicalDevice);
+    CreateDepthImage(physicalDevice);
+    CreateFrameBuffers(renderPass);
+
+    mOutOfDate = false;
 }
 
 void VulkanSwapChain::CleanUp()
 {
-    for (size_t i = 0; i < 2; i++) {
+    for (size_t i = 0; i < mDescriptor.FramesInFlight; i++) {
         vkDestroySemaphore(mDevice, mRenderFinishedSemaphore[i], nullptr);
         vkDestroySemaphore(mDevice, mImageAvailableSemaphore[i], nullptr);
         vkDestroyFence(mDevice, mInFlightFence[i], nullptr);
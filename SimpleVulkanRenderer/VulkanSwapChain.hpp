@@ -11,9 +11,15 @@ struct SwapChainDescriptor
 {
 	/// <summary>
 	/// The number of images the swap chain should use.
+	/// Defaults to one more than the surface minimum, or FramesInFlight when headless.
 	/// </summary>
 	std::optional<int> ImageCount;
 	/// <summary>
+	/// The number of frames the CPU may record ahead of the GPU.
+	/// Synchronization objects, frame command buffers and per frame uniforms are sized from this.
+	/// </summary>
+	int FramesInFlight = 2;
+	/// <summary>
 	/// The prefered presentation mode to select.
 	/// If the selected mode is not supported, VK_PRESENT_MODE_FIFO_KHR is selected instead.
 	/// </summary>
@@ -66,6 +72,14 @@ public:
 
 	void InitializeSwapChain(GLFWwindow* window, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice);
 
+	/// <summary>
+	/// Initialize without a window or surface.
+	/// 
+	/// A ring of offscreen color images stands in for the swap chain images. Frames are
+	/// rendered into them in turn and never presented.
+	/// </summary>
+	void InitializeOffscreen(VkPhysicalDevice physicalDevice, VkExtent2D extent);
+
 	void CreateDepthImage(VkPhysicalDevice physicalDevice);
 
 	void CreateFrameBuffers(VkRenderPass renderPass);
@@ -75,16 +89,41 @@ public:
 	/// <summary>
 	/// Start the drawing of a frame, CurrentFrame() should already
 	/// represent the frame you want to start drawing on.
+	/// 
+	/// If the swap chain is out of date, no image is acquired and OutOfDate() is set.
+	/// The swap chain must be recreated before calling this again.
 	/// </summary>
-	/// TODO :: Handle swapchain recreation.
 	uint32_t StartFrameDrawing();
 
 	/// <summary>
 	/// Ends frame drawing and tells the frame
 	/// command buffer to be submited.
+	/// 
+	/// Sets OutOfDate() if presentation reports the swap chain no longer matches the surface.
 	/// </summary>
 	void EndFrameDrawing(VkQueue graphicsQueue, VkCommandBuffer commandBuffer, VkQueue presentationQueue, bool& framebufferResized, uint32_t imageIndex);
 
+	/// <summary>
+	/// Wait until the GPU has finished every frame in flight.
+	/// 
+	/// Cheaper than vkDeviceWaitIdle() since work on other queues (such as resource loading) is not waited on.
+	/// </summary>
+	void WaitForFramesInFlight();
+
+	/// <summary>
+	/// Destroy the resources that depend on the swap chain images: the framebuffers, depth image and image views.
+	/// </summary>
+	void DestroyImageResources();
+
+	/// <summary>
+	/// Recreate the swap chain for the current surface size.
+	/// 
+	/// The old swap chain is handed to the new one for a fast handover. Only the image views, depth image
+	/// and framebuffers are rebuilt, everything else (render pass, pipelines, synchronization objects) is kept.
+	/// </summary>
+	/// <param name="presentQueue">Waited on before the old swap chain is destroyed, so no present still uses it.</param>
+	void RecreateSwapChain(GLFWwindow* window, VkSurfaceKHR surface, VkPhysicalDevice physicalDevice, VkRenderPass renderPass, VkQueue presentQueue);
+
 	void CleanUp();
 
 	// Getters
@@ -94,11 +133,34 @@ public:
 		return mCurrentFrame;
 	}
 
+	const int FramesInFlight()
+	{
+		return mDescriptor.FramesInFlight;
+	}
+
+	const bool OutOfDate()
+	{
+		return mOutOfDate;
+	}
+
 	const VkSwapchainKHR SwapChain()
 	{
 		return mSwapChain;
 	}
 
+	/// <summary>
+	/// If the images are offscreen images owned by this class rather than a presentable swap chain.
+	/// </summary>
+	const bool Headless()
+	{
+		return mHeadless;
+	}
+
+	const std::vector<VkDeviceMemory>& OffscreenImageMemory()
+	{
+		return mOffscreenImageMemory;
+	}
+
 	const VkExtent2D& Extent()
 	{
 		return mSwapChainExtent;
@@ -149,6 +211,10 @@ private:
 	VkSwapchainKHR mSwapChain;
 	VkExtent2D mSwapChainExtent;
 
+	bool mHeadless;
+	// Only used when headless, the memory backing each offscreen image.
+	std::vector<VkDeviceMemory> mOffscreenImageMemory;
+
 	VkFormat mSwapChainImageFormat;
 	std::vector<VkImage> mSwapChainImages;
 	std::vector<VkImageView> mSwapChainImageViews;
@@ -166,6 +232,7 @@ private:
 	// Current State:
 	size_t mCurrentFrame;
 	uint32_t mCurrentImageIndex;
+	bool mOutOfDate;
 
 
 	// General Pipline Info Storage
@@ -48,9 +48,11 @@ VulkanVertexShader::VulkanVertexShader(VkDevice device, std::string name, std::s
     this->vertexShaderStageInfo = vertexShaderStageInfo;
 }
 
-VkPipelineShaderStageCreateInfo VulkanVertexShader::GetShaderStage()
+VkPipelineShaderStageCreateInfo VulkanVertexShader::GetShaderStage(const VkSpecializationInfo* specializationInfo)
 {
-    return vertexShaderStageInfo;
+    VkPipelineShaderStageCreateInfo stageInfo = vertexShaderStageInfo;
+    stageInfo.pSpecializationInfo = specializationInfo;
+    return stageInfo;
 }
 
 void VulkanVertexShader::DestroyShaderModuleIfNeeded(VkDevice device)
@@ -16,8 +16,9 @@ public:
 	/// <summary>
 	/// Get the current shader stage.
 	/// </summary>
+	/// <param name="specializationInfo">The specialization constants, must stay valid until the pipeline is created.</param>
 	/// <returns>The current shader stage.</returns>
-	VkPipelineShaderStageCreateInfo GetShaderStage() override;
+	VkPipelineShaderStageCreateInfo GetShaderStage(const VkSpecializationInfo* specializationInfo = nullptr) override;
 
 	void DestroyShaderModuleIfNeeded(VkDevice device) override;
 
@@ -5,6 +5,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <cstdlib>
+#include <cctype>
 #include <cstring>
 #include <vector>
 #include <optional>
@@ -12,18 +13,23 @@
 #include <cstdint>
 #include <algorithm>
 #include <array>
+#include <deque>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdlib.h>
 #include <time.h>
 
 #include <atomic>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "VulkanRenderer.hpp"
 #include "VulkanVertexShader.hpp"
 #include "VulkanFragmentShader.hpp"
 #include "VulkanTexture.hpp"
 #include "VulkanMappedBuffer.hpp"
+#include "CpuProfiler.hpp"
 #include "Camera.hpp"
 #include "Chunk.hpp"
 
@@ -33,6 +39,10 @@ constexpr auto WIDTH = 1080;
 constexpr auto HEIGHT = 720;
 
 constexpr auto NUM_RESOURCE_THREADS = 2;
+// The number of threads remeshing edited chunks and chunks that changed level of detail.
+constexpr auto NUM_REMESH_THREADS = 2;
+// The number of threads recording chunk draws into secondary command buffers.
+constexpr auto NUM_RECORDING_THREADS = 4;
 
 std::shared_ptr<VulkanRenderer> renderer;
 
@@ -43,6 +53,7 @@ std::shared_ptr<VulkanRenderer> renderer;
 */
 Camera camera;
 std::vector<Ptr(Chunk)> chunks;
+glm::ivec3 chunkGridSize;
 
 VulkanBuffer vertexBuffer;
 std::vector<Vertex> vertices;
@@ -63,8 +74,15 @@ struct UniformBufferObject {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
 };
+
+// Matches the push constant block of shaders/chunk_push.vert.
+struct ChunkPushConstants {
+    glm::vec3 origin;
+};
 VulkanFrameObject<VulkanMappedBuffer> mappedUniformBuffers;
 glm::mat4 modelMatrix;
+// Bump whenever modelMatrix changes, so the chunk model matrices are only rewritten when it does.
+uint64_t modelMatrixVersion = 1;
 
 // ========================= [ Chunk Demo Settings ] ==================
 constexpr auto NUMBER_OF_CHUNKS = 2;
@@ -77,6 +95,7 @@ std::vector<std::thread> chunkLoadingThreads;
 
 void PopulateChunks(int sx, int sy, int sz)
 {
+    chunkGridSize = glm::ivec3(sx, sy, sz);
     for (int x = 0; x < sx; x++)
     {
         for (int y = 0; y < sy; y++)
@@ -87,18 +106,64 @@ void PopulateChunks(int sx, int sy, int sz)
             }
         }
     }
+
+    // Link each chunk to its neighbours so the border faces between them can be culled.
+    auto chunkIndex = [sy, sz](int x, int y, int z) { return (x * sy + y) * sz + z; };
+    for (int x = 0; x < sx; x++)
+    {
+        for (int y = 0; y < sy; y++)
+        {
+            for (int z = 0; z < sz; z++)
+            {
+                auto& chunk = chunks[chunkIndex(x, y, z)];
+                if (x > 0) chunk->SetNeighbour(LEFT_FACE, chunks[chunkIndex(x - 1, y, z)].get());
+                if (x < sx - 1) chunk->SetNeighbour(RIGHT_FACE, chunks[chunkIndex(x + 1, y, z)].get());
+                if (y > 0) chunk->SetNeighbour(BOTTOM_FACE, chunks[chunkIndex(x, y - 1, z)].get());
+                if (y < sy - 1) chunk->SetNeighbour(TOP_FACE, chunks[chunkIndex(x, y + 1, z)].get());
+                if (z > 0) chunk->SetNeighbour(BACK_FACE, chunks[chunkIndex(x, y, z - 1)].get());
+                if (z < sz - 1) chunk->SetNeighbour(FRONT_FACE, chunks[chunkIndex(x, y, z + 1)].get());
+            }
+        }
+    }
 }
 
+// Counts down as the loading threads finish generating their voxels, guarded by voxelPhaseMutex.
+std::mutex voxelPhaseMutex;
+std::condition_variable voxelPhaseCondition;
+int voxelPhaseRemaining = NUM_RESOURCE_THREADS;
+
 void LoadChunks(int id)
 {
-    auto pool = renderer->CreateCommandPool(("ResourceLoader" + id), resourceLoadingQueues[id]);
+    CPU_PROFILE_THREAD_NAME("ResourceLoader" + std::to_string(id));
+    // Only this thread uses the pool. Its uploads are waited on, so the pool is reset in bulk after every chunk.
+    auto pool = renderer->CreateCommandPool(("ResourceLoader" + id), resourceLoadingQueues[id], true);
+    // Reused for every chunk this thread meshes.
+    ChunkMeshingWorkspace workspace(renderer->mBufferUtilities);
 
     int startingLocation = std::floor(chunks.size() / NUM_RESOURCE_THREADS) * id;
     int endingLocation = (std::floor(chunks.size() / NUM_RESOURCE_THREADS) * (id + 1));
 
     for (int i = startingLocation; i < endingLocation; i++)
     {
-        chunks[i]->GenerateChunk(renderer->mBufferUtilities, pool, resourceLoadingQueues[id]);
+        chunks[i]->GenerateVoxels();
+    }
+
+    // A chunk can only be meshed once the voxels of all of its neighbours exist,
+    // and some neighbours belong to the other loading threads. Sleep until they have generated theirs.
+    {
+        CPU_PROFILE_ZONE("WaitForVoxels");
+        std::unique_lock<std::mutex> lock(voxelPhaseMutex);
+        if (--voxelPhaseRemaining == 0)
+        {
+            voxelPhaseCondition.notify_all();
+        }
+        voxelPhaseCondition.wait(lock, [] { return voxelPhaseRemaining == 0; });
+    }
+
+    for (int i = startingLocation; i < endingLocation; i++)
+    {
+        chunks[i]->GenerateMesh(renderer->mBufferUtilities, renderer->DeletionQueue(), pool, resourceLoadingQueues[id], workspace);
+        pool->Reset(renderer->mDevice);
     }
 }
 
@@ -110,16 +175,273 @@ void StartLoading() {
 
 // ========================= [ Multi Threading] ==================
 
+// ========================= [ Chunk Editing ] ==================
+
+std::mutex remeshMutex;
+std::condition_variable remeshCondition;
+// Guarded by remeshMutex: the chunks waiting to be remeshed, the same chunks as a set, and the chunks being remeshed.
+std::deque<Ptr(Chunk)> remeshChunks;
+std::unordered_set<Chunk*> queuedRemeshChunks;
+std::unordered_set<Chunk*> busyRemeshChunks;
+std::atomic_bool remeshRunning = true;
+std::vector<std::thread> remeshThreads;
+// One per remesh thread, so uploads never wait on another thread's submissions.
+std::vector<VulkanQueue> remeshQueues;
+
+Ptr(Chunk) ChunkAt(glm::ivec3 voxel)
+{
+    glm::ivec3 chunkPos(
+        (int)std::floor(voxel.x / (float)CHUNK_VOXEL_COUNT),
+        (int)std::floor(voxel.y / (float)CHUNK_VOXEL_COUNT),
+        (int)std::floor(voxel.z / (float)CHUNK_VOXEL_COUNT));
+    if (chunkPos.x < 0 || chunkPos.y < 0 || chunkPos.z < 0 || chunkPos.x >= chunkGridSize.x || chunkPos.y >= chunkGridSize.y || chunkPos.z >= chunkGridSize.z)
+    {
+        return nullptr;
+    }
+
+    return chunks[(chunkPos.x * chunkGridSize.y + chunkPos.y) * chunkGridSize.z + chunkPos.z];
+}
+
+/// <summary>
+/// The position of the camera in voxel space.
+/// </summary>
+glm::vec3 CameraVoxelPosition()
+{
+    glm::vec4 voxelPos = glm::inverse(modelMatrix) * glm::vec4(camera.Position(), 1.0f);
+    return glm::vec3(voxelPos.x, voxelPos.y, voxelPos.z);
+}
+
+/// <summary>
+/// Pick the level of detail of every chunk from its distance to the camera.
+/// 
+/// Chunks that change level are marked dirty and remeshed like any other edit.
+/// </summary>
+void UpdateChunkLods()
+{
+    CPU_PROFILE_ZONE("UpdateChunkLods");
+    glm::vec3 cameraPos = CameraVoxelPosition();
+    for (auto& chunk : chunks)
+    {
+        glm::vec3 center = chunk->Location() + glm::vec3(CHUNK_VOXEL_COUNT / 2.0f, CHUNK_VOXEL_COUNT / 2.0f, CHUNK_VOXEL_COUNT / 2.0f);
+        float distance = glm::distance(cameraPos, center);
+
+        int lod = 0;
+        while (lod < CHUNK_LOD_COUNT - 1 && distance > CHUNK_LOD_DISTANCES[lod])
+        {
+            lod++;
+        }
+        chunk->SetLod(lod);
+    }
+}
+
+// ========================= [ Memory Budget ] ==================
+
+// The most memory the chunks may hold in voxels, meshes and mesh buffers. Zero for no limit.
+uint64_t chunkMemoryBudget = 0;
+// Evicted chunks are only restored while the chunks stay under this fraction of the budget,
+// so chunks near the limit don't flip between evicted and restored every frame.
+constexpr double CHUNK_RESTORE_FRACTION = 0.9;
+// The lowest chunk budget a device local heap over its driver budget has called for, kept so that
+// restoring follows CHUNK_RESTORE_FRACTION of it. UINT64_MAX until a heap has gone over.
+uint64_t driverChunkMemoryBudget = UINT64_MAX;
+
+/// <summary>
+/// Keep the chunks within chunkMemoryBudget and the device's memory budget.
+/// 
+/// Over budget, the meshes of the chunks furthest from the camera are evicted. Under budget,
+/// the nearest evicted chunks are remeshed again while they fit. Once the driver reports a heap over budget,
+/// the budget it implies is kept, so the evicted chunks don't all come back as soon as the heap is under again.
+/// </summary>
+void EnforceMemoryBudget()
+{
+    CPU_PROFILE_ZONE("EnforceMemoryBudget");
+    uint64_t budget = chunkMemoryBudget != 0 ? chunkMemoryBudget : UINT64_MAX;
+
+    glm::vec3 cameraPos = CameraVoxelPosition();
+    std::vector<std::pair<float, Ptr(Chunk)>> chunksByDistance;
+    uint64_t resident = 0;
+    for (auto& chunk : chunks)
+    {
+        if (!chunk->FinishedGenerating()) continue;
+
+        glm::vec3 center = chunk->Location() + glm::vec3(CHUNK_VOXEL_COUNT / 2.0f, CHUNK_VOXEL_COUNT / 2.0f, CHUNK_VOXEL_COUNT / 2.0f);
+        chunksByDistance.push_back({ glm::distance(cameraPos, center), chunk });
+        resident += chunk->MemoryUsage();
+    }
+
+    // If the driver reports a device local heap over its budget, shed at least the overshoot.
+    // Freed buffers only show up once the deletion queue destroys them, a few frames later.
+    if (renderer->MemoryBudgetSupported())
+    {
+        for (auto& heap : renderer->QueryMemoryBudget())
+        {
+            if (!heap.DeviceLocal || heap.Usage <= heap.Budget) continue;
+
+            uint64_t overshoot = heap.Usage - heap.Budget;
+            driverChunkMemoryBudget = std::min(driverChunkMemoryBudget, resident > overshoot ? resident - overshoot : 0);
+        }
+    }
+    budget = std::min(budget, driverChunkMemoryBudget);
+
+    // Nothing has ever been evicted without a budget.
+    if (budget == UINT64_MAX)
+    {
+        for (auto& entry : chunksByDistance)
+        {
+            entry.second->RestoreMesh();
+        }
+        return;
+    }
+
+    // Furthest first.
+    std::sort(chunksByDistance.begin(), chunksByDistance.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    if (resident > budget)
+    {
+        for (auto& entry : chunksByDistance)
+        {
+            if (resident <= budget) break;
+            if (entry.second->Evicted() || entry.second->MeshMemory() == 0) continue;
+
+            resident -= std::min<uint64_t>(resident, entry.second->EvictMesh(renderer->DeletionQueue()));
+        }
+        return;
+    }
+
+    uint64_t restoreBudget = (uint64_t)(budget * CHUNK_RESTORE_FRACTION);
+    for (auto it = chunksByDistance.rbegin(); it != chunksByDistance.rend(); it++)
+    {
+        if (!it->second->Evicted()) continue;
+
+        uint64_t cost = it->second->EvictedMemory();
+        if (resident + cost > restoreBudget) break;
+
+        it->second->RestoreMesh();
+        resident += cost;
+    }
+}
+
+/// <summary>
+/// Set every voxel within a sphere (in voxel space) to the given value.
+/// </summary>
+void EditSphere(glm::vec3 center, float radius, int value)
+{
+    // Group the edits by chunk so each chunk applies them as a single batch.
+    std::unordered_map<Chunk*, std::vector<VoxelEdit>> chunkEdits;
+    int extent = (int)std::ceil(radius);
+    glm::ivec3 centerVoxel((int)std::floor(center.x), (int)std::floor(center.y), (int)std::floor(center.z));
+    for (int x = -extent; x <= extent; x++)
+    {
+        for (int y = -extent; y <= extent; y++)
+        {
+            for (int z = -extent; z <= extent; z++)
+            {
+                if (x * x + y * y + z * z > radius * radius) continue;
+
+                glm::ivec3 voxel = centerVoxel + glm::ivec3(x, y, z);
+                auto chunk = ChunkAt(voxel);
+                if (chunk == nullptr || !chunk->VoxelsGenerated()) continue;
+
+                glm::vec3 location = chunk->Location();
+                chunkEdits[chunk.get()].push_back({ voxel.x - (int)location.x, voxel.y - (int)location.y, voxel.z - (int)location.z, value });
+            }
+        }
+    }
+
+    for (auto& edits : chunkEdits)
+    {
+        edits.first->SetVoxels(edits.second);
+    }
+}
+
+void RemeshChunks(int id)
+{
+    CPU_PROFILE_THREAD_NAME("Remesher" + std::to_string(id));
+    auto pool = renderer->CreateCommandPool("Remesher" + std::to_string(id), remeshQueues[id], true);
+    ChunkMeshingWorkspace workspace(renderer->mBufferUtilities);
+
+    // The first queued chunk no other thread is meshing.
+    auto nextChunk = []() {
+        return std::find_if(remeshChunks.begin(), remeshChunks.end(), [](const Ptr(Chunk)& chunk) {
+            return busyRemeshChunks.count(chunk.get()) == 0;
+        });
+    };
+
+    while (true)
+    {
+        Ptr(Chunk) chunk;
+        {
+            std::unique_lock<std::mutex> lock(remeshMutex);
+            remeshCondition.wait(lock, [&nextChunk] { return nextChunk() != remeshChunks.end() || !remeshRunning; });
+            if (!remeshRunning) return;
+
+            auto next = nextChunk();
+            chunk = *next;
+            remeshChunks.erase(next);
+            queuedRemeshChunks.erase(chunk.get());
+            // A chunk is never meshed on two threads at once, a second remesh waits in the queue until this one is done.
+            busyRemeshChunks.insert(chunk.get());
+        }
+
+        chunk->GenerateMesh(renderer->mBufferUtilities, renderer->DeletionQueue(), pool, remeshQueues[id], workspace);
+        pool->Reset(renderer->mDevice);
+
+        {
+            std::lock_guard<std::mutex> lock(remeshMutex);
+            busyRemeshChunks.erase(chunk.get());
+        }
+        // Another thread may be waiting for this chunk to be free.
+        remeshCondition.notify_all();
+    }
+}
+
+/// <summary>
+/// Hand the chunks edited since the last frame to the remesh threads.
+/// 
+/// Edits only set a dirty flag, so a chunk is remeshed once per frame no matter how many of its voxels changed.
+/// A chunk that is still queued is not queued again, its remesh picks up every change made before it starts.
+/// </summary>
+void QueueDirtyChunks()
+{
+    std::vector<Ptr(Chunk)> dirtyChunks;
+    for (auto& chunk : chunks)
+    {
+        // Evicted chunks keep their dirty flag, they are remeshed once restored.
+        if (chunk->FinishedGenerating() && !chunk->Evicted() && chunk->ConsumeDirty())
+        {
+            dirtyChunks.push_back(chunk);
+        }
+    }
+
+    if (dirtyChunks.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(remeshMutex);
+        for (auto& chunk : dirtyChunks)
+        {
+            if (queuedRemeshChunks.insert(chunk.get()).second)
+            {
+                remeshChunks.push_back(chunk);
+            }
+        }
+    }
+    remeshCondition.notify_all();
+}
+
+// ========================= [ Chunk Editing ] ==================
+
 std::shared_ptr<VulkanVertexShader> CreateVertexShader(VkDevice device)
 {
-    auto vertexShader = std::make_shared<VulkanVertexShader>(device, "main", "shaders/vert.spv");
+    auto vertexShader = std::make_shared<VulkanVertexShader>(device, "main", CHUNK_PUSH_CONSTANT_TRANSFORMS ? "shaders/vert_push.spv" : "shaders/vert.spv");
     vertexShader->VertexAttribute(0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Vertex::pos));
     vertexShader->VertexAttribute(0, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, Vertex::color));
     vertexShader->VertexAttribute(0, 2, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, Vertex::texCoord));
-    vertexShader->VertexAttributeMatrix4f(1, 3);
-    
     vertexShader->VertexUniformBinding(0, sizeof(Vertex));
-    vertexShader->VertexUniformBinding(1, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE);
+
+    if (!CHUNK_PUSH_CONSTANT_TRANSFORMS)
+    {
+        vertexShader->VertexAttributeMatrix4f(1, 3);
+        vertexShader->VertexUniformBinding(1, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE);
+    }
 
     return vertexShader;
 }
@@ -138,31 +460,20 @@ void SetupBuffers()
     renderer->mBufferUtilities->MapMemory(modelMatrixBuffer, 0, sizeof(glm::mat4) * 2, 0, modelMatrixBuffer.DirectMappedMemory());
     // Uniform Buffers
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-    mappedUniformBuffers = VulkanFrameObject<VulkanMappedBuffer>(2 /*Swapchain Size*/);
-    // Create a uniform buffer for each swapchain image.
-    for (size_t i = 0; i < 2; i++) {
+    mappedUniformBuffers = VulkanFrameObject<VulkanMappedBuffer>(renderer->SwapChain()->FramesInFlight());
+    // Create a uniform buffer for each frame in flight.
+    for (size_t i = 0; i < renderer->SwapChain()->FramesInFlight(); i++) {
         renderer->mBufferUtilities->CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, mappedUniformBuffers[i], mappedUniformBuffers[i]);
         renderer->mBufferUtilities->MapMemory(mappedUniformBuffers[i], 0, sizeof(UniformBufferObject), 0, mappedUniformBuffers[i].DirectMappedMemory());
     }
 }
-void UpdateUniformBuffer(uint32_t currentImage) {
+void UpdateUniformBuffer(uint32_t currentFrame) {
     // Use static to keep track of the previous time.
     static auto startTime = std::chrono::high_resolution_clock::now();
     auto currentTime = std::chrono::high_resolution_clock::now();
     // The delta time in seconds.
     float time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
 
-    for (int i = 0; i < chunks.size(); i++)
-    {
-        if (chunks[i]->FinishedGenerating() && chunks[i]->IndiciesSize() > 0)
-        {
-            glm::mat4 chunkModelMatrix = glm::translate(modelMatrix, chunks[i]->Location());
-            //modelMatrices[i] = glm::mat4(1.0f);
-            //modelMatrices[i] = modelMatrix;
-            memcpy(chunks[i]->ModelBuffer().MappedMemory(), &chunkModelMatrix, sizeof(glm::mat4));
-        }
-    }
-
     UniformBufferObject ubo{};
     // Create the model matrix.
     // This rotates the model on the Z-Axis, accounting for the deltaTime.
@@ -178,7 +489,7 @@ void UpdateUniformBuffer(uint32_t currentImage) {
     ubo.proj[1][1] *= -1;
 
     // Copy the data in the uniform buffer object to the current uniform buffer.
-    memcpy(mappedUniformBuffers[currentImage].MappedMemory(), &ubo, sizeof(ubo));
+    memcpy(mappedUniformBuffers[currentFrame].MappedMemory(), &ubo, sizeof(ubo));
 }
 
 
@@ -190,17 +501,166 @@ void CleanUpBuffers()
     vertexBuffer.DestoryBuffer(renderer->mDevice);
     modelMatrixBuffer.DestoryBuffer(renderer->mDevice);
 
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < renderer->SwapChain()->FramesInFlight(); i++)
     {
         mappedUniformBuffers[i].DestoryBuffer(renderer->mDevice);
     }
 }
 
-int main() {
+/// <summary>
+/// Handle the keyboard controls of the demo.
+/// </summary>
+void ProcessInput(float deltaTime)
+{
+    // Display the FPS and the GPU time of the main pass on the title.
+    std::string title = "Vulkan Test | FPS: " + std::to_string(1 / deltaTime);
+    if (renderer->GpuProfiler() != nullptr && renderer->GpuProfiler()->Supported())
+    {
+        title += " | GPU: " + std::to_string(renderer->GpuProfiler()->Milliseconds("MainPass")) + " ms";
+    }
+    glfwSetWindowTitle(renderer->mWindow, title.c_str());
+
+    // If the left key is press, rotate the object left.
+    int leftKeyState = glfwGetKey(renderer->mWindow, GLFW_KEY_LEFT);
+    if (leftKeyState == GLFW_PRESS) {
+        //modelMatrix = glm::rotate(modelMatrix, deltaTime * glm::radians(90.0f), glm::vec3(0.0f, -1.0f, 0.0f));
+        camera.MoveLeft(5 * deltaTime);
+    }
+
+    // If the right key is pressed, rotate the object right.
+    int rightKeyState = glfwGetKey(renderer->mWindow, GLFW_KEY_RIGHT);
+    if (rightKeyState == GLFW_PRESS) {
+       //modelMatrix = glm::rotate(modelMatrix, deltaTime * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        camera.MoveRight(5 * deltaTime);
+    }
+
+    if (glfwGetKey(renderer->mWindow, GLFW_KEY_UP) == GLFW_PRESS) {
+        camera.MoveForward(5 * deltaTime);
+    }
+
+    if (glfwGetKey(renderer->mWindow, GLFW_KEY_DOWN) == GLFW_PRESS) {
+        camera.MoveBackward(5 * deltaTime);
+    }
+
+    // If the right key is pressed, rotate the object right.
+    int shiftKeyState = glfwGetKey(renderer->mWindow, GLFW_KEY_LEFT_SHIFT);
+    if (shiftKeyState == GLFW_PRESS) {
+        modelMatrix = glm::translate(modelMatrix, glm::vec3(0, -1 * deltaTime, 0));
+        modelMatrixVersion++;
+    }
+
+    // Dig out the voxels around the camera.
+    if (glfwGetKey(renderer->mWindow, GLFW_KEY_E) == GLFW_PRESS) {
+        EditSphere(CameraVoxelPosition(), 3, 0);
+    }
+}
+
+// ========================= [ Chunk Drawing ] ==================
+
+struct ChunkDraw {
+    Ptr(Chunk) chunk;
+    std::shared_ptr<ChunkMesh> mesh;
+};
+// The chunks with a mesh this frame, in draw order.
+std::vector<ChunkDraw> chunkDraws;
+
+// Record the draws [begin, end) of chunkDraws. Runs on the recording threads when recording in parallel,
+// each with its own range, so the per chunk work here must not touch other chunks.
+void RecordChunkDraws(Ptr(VulkanCommandBuffer) commandBuffer, size_t currentFrame, size_t begin, size_t end)
+{
+    CPU_PROFILE_ZONE("RecordChunkDraws");
+    auto pipeline = renderer->PrimaryGraphicsPipeline();
+    VkDescriptorSet descriptorSet = renderer->DescriptorHandler()->DescriptorSetBuilder()->GetBuiltDescriptorSets()[currentFrame];
+
+    commandBuffer->BindPipeline(pipeline->Pipeline());
+    commandBuffer->SetViewportScissor(renderer->SwapChain()->Extent());
+
+    for (size_t i = begin; i < end; i++)
+    {
+        auto& chunk = chunkDraws[i].chunk;
+        auto& mesh = chunkDraws[i].mesh;
+
+        commandBuffer->BindVertexBuffer(mesh->VertexBuffer);
+        commandBuffer->BindIndexBuffer(mesh->IndexBuffer);
+        if (CHUNK_PUSH_CONSTANT_TRANSFORMS)
+        {
+            ChunkPushConstants pushConstants{ chunk->Location() };
+            commandBuffer->PushConstants(pipeline->PipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ChunkPushConstants), &pushConstants);
+        }
+        else
+        {
+            // Written while collecting the draws.
+            commandBuffer->BindVertexBuffer(chunk->ModelBuffer(), 0, 1); // Bind matrix buffer.
+        }
+        commandBuffer->BindDescriptorSet(pipeline->PipelineLayout(), descriptorSet);
+        commandBuffer->DrawIndexed(mesh->IndexCount);
+    }
+}
+
+// Identifies everything the recorded chunk draws depend on besides the uniform buffer: the swap chain extent,
+// the pipeline and the visible meshes. The recorder reuses its buffers while this stays the same.
+// The root transform is not part of it, the draws bind the model buffers by handle and push the chunk locations.
+VulkanRecordingKey chunkDrawsKey;
+
+const VulkanRecordingKey& ChunkDrawsKey()
+{
+    chunkDrawsKey.Clear();
+    chunkDrawsKey.Add(renderer->SwapChain()->Extent().width);
+    chunkDrawsKey.Add(renderer->SwapChain()->Extent().height);
+    chunkDrawsKey.Add((uint64_t)renderer->PrimaryGraphicsPipeline()->Pipeline());
+    for (auto& draw : chunkDraws)
+    {
+        chunkDrawsKey.Add(draw.mesh->Id);
+    }
+    return chunkDrawsKey;
+}
+
+int main(int argc, char** argv) {
     srand(time(NULL));
+    CPU_PROFILE_THREAD_NAME("Render");
+
+    // --headless [frames]: Render offscreen without a window. Once the chunks have loaded,
+    // the given number of frames (1000 by default) is timed and the program exits.
+    // --gpu-log <file>: Write the GPU time of every pass of every frame to a CSV file.
+    // --cpu-trace <file>: Write the CPU zones of every thread as a Chrome trace when the program exits.
+    // --memory-budget <MiB>: Evict the meshes of far chunks to keep the chunks within the budget.
+    bool headless = false;
+    int headlessFrameCount = 1000;
+    std::string gpuLogPath;
+    std::string cpuTracePath;
+    for (int i = 1; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--headless")
+        {
+            headless = true;
+            if (i + 1 < argc && std::isdigit(argv[i + 1][0]))
+            {
+                headlessFrameCount = std::atoi(argv[++i]);
+            }
+        }
+        else if (std::string(argv[i]) == "--gpu-log" && i + 1 < argc)
+        {
+            gpuLogPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--cpu-trace" && i + 1 < argc)
+        {
+            cpuTracePath = argv[++i];
+            CpuProfiler::SetCapturing(true);
+        }
+        else if (std::string(argv[i]) == "--memory-budget" && i + 1 < argc)
+        {
+            chunkMemoryBudget = std::strtoull(argv[++i], nullptr, 10) * 1024 * 1024;
+        }
+    }
 
     PopulateChunks(20, 2, 20);
 
+    // The world transform is needed to place the camera before the chunks start loading.
+    modelMatrix = glm::mat4(1.0f);
+    modelMatrix = glm::scale(modelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
+    modelMatrix = glm::rotate(modelMatrix, (float)glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    modelMatrix = glm::translate(modelMatrix, glm::vec3(-5*CHUNK_VOXEL_COUNT, -2 * CHUNK_VOXEL_COUNT, -5 * CHUNK_VOXEL_COUNT));
+
     renderer = std::make_shared<VulkanRenderer>();
 
     VulkanAutoInitSettings autoInitSettings;
@@ -210,6 +670,8 @@ int main() {
     autoInitSettings.WindowHeight = HEIGHT;
     autoInitSettings.WindowWidth = WIDTH;
     autoInitSettings.WindowName = "Test Renderer Application";
+    autoInitSettings.Headless = headless;
+    autoInitSettings.RecordingThreads = NUM_RECORDING_THREADS;
     
     for (int i = 0; i < NUM_RESOURCE_THREADS; i++)
     {
@@ -220,6 +682,15 @@ int main() {
         autoInitSettings.CustomQueues.push_back(queueDescriptor);
     }
 
+    for (int i = 0; i < NUM_REMESH_THREADS; i++)
+    {
+        VulkanQueueDescriptor remeshQueueDescriptor;
+        remeshQueueDescriptor.Type = COMPUTE_QUEUE;
+        remeshQueueDescriptor.Priority = 0.9f;
+        remeshQueueDescriptor.Name = "RemeshQueue" + std::to_string(i);
+        autoInitSettings.CustomQueues.push_back(remeshQueueDescriptor);
+    }
+
     renderer->AutoInitialize(
         autoInitSettings,
         [](auto descriptorLayout) { /* Create Default Descriptor Layout */
@@ -231,6 +702,10 @@ int main() {
             GraphicsPipelineDescriptor pipeline;
             pipeline.VertexShader = CreateVertexShader(renderer->mDevice);
             pipeline.FragmentShader = CreateFragmentShader(renderer->mDevice);
+            if (CHUNK_PUSH_CONSTANT_TRANSFORMS)
+            {
+                pipeline.PushConstantRanges.push_back({ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ChunkPushConstants) });
+            }
             return pipeline;
         },
         []() { /* General Loading Stage */
@@ -240,8 +715,18 @@ int main() {
                 resourceLoadingQueues.push_back(renderer->GetNamedVulkanQueue("ResourceLoadingQueue" + i));
             }
 
+            for (int i = 0; i < NUM_REMESH_THREADS; i++) {
+                remeshQueues.push_back(renderer->GetNamedVulkanQueue("RemeshQueue" + std::to_string(i)));
+            }
+
+            // Pick the initial levels of detail so distant chunks are meshed coarse right away.
+            UpdateChunkLods();
+
             // Start the Threading
             StartLoading();
+            for (int i = 0; i < NUM_REMESH_THREADS; i++) {
+                remeshThreads.push_back(std::thread(RemeshChunks, i));
+            }
         },
         [](auto setBuilder) { /* Create the default descriptor sets for each framebuffer. */
             VulkanTexture texture("textures/texture.jpg", renderer, renderer->mBufferUtilities);
@@ -250,95 +735,135 @@ int main() {
         }
     );
 
+    // Every chunk binds the same pipeline and descriptor set, skip rebinding what is already bound.
+    // The frame pools hand out the same command buffer objects after every reset, so this only needs setting once.
+    for (auto& commandPool : renderer->mFrameCommandPools.InternalVector())
+    {
+        for (auto& commandBuffer : commandPool->CommandBuffers())
+        {
+            commandBuffer->SetStateTracking(true);
+        }
+    }
+
+    if (!gpuLogPath.empty() && renderer->GpuProfiler() != nullptr)
+    {
+        renderer->GpuProfiler()->SetLogFile(gpuLogPath);
+    }
+
     bool finished = false;
     auto startTime = std::chrono::high_resolution_clock::now();
 
     // Main Loop::
-    modelMatrix = glm::mat4(1.0f);
-    modelMatrix = glm::scale(modelMatrix, glm::vec3(0.5f, 0.5f, 0.5f));
-    modelMatrix = glm::rotate(modelMatrix, (float)glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-    modelMatrix = glm::translate(modelMatrix, glm::vec3(-5*CHUNK_VOXEL_COUNT, -2 * CHUNK_VOXEL_COUNT, -5 * CHUNK_VOXEL_COUNT));
 
-    glfwSetCursorPosCallback(renderer->mWindow, [](GLFWwindow* window, double x, double y) {
-        camera.mouse_callback(window, x, y);
-        });
-    glfwSetInputMode(renderer->mWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    if (!headless) {
+        glfwSetCursorPosCallback(renderer->mWindow, [](GLFWwindow* window, double x, double y) {
+            camera.mouse_callback(window, x, y);
+            });
+        glfwSetInputMode(renderer->mWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    }
     // Keep track of the last loop time.
     auto lastLoopTime = std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::system_clock::now().time_since_epoch()).count() / 1000000000.0;
     // Event loop.
-    while (!glfwWindowShouldClose(renderer->mWindow)) {
-        glfwPollEvents();
+    // The frames timed once loading has finished in headless mode.
+    int timedFrames = 0;
+    auto timingStartTime = std::chrono::high_resolution_clock::now();
+    VulkanCommandStatistics lastFrameStatistics;
+    // The timed frames that reused the chunk draws recorded for an earlier frame.
+    int reusedFrames = 0;
+    // The GPU time of the main pass summed over the timed frames whose timings were resolved.
+    double gpuMainPassMilliseconds = 0;
+    uint64_t gpuTimedFrames = 0;
+    uint64_t lastResolvedGpuFrame = 0;
+    while (headless ? timedFrames < headlessFrameCount : !glfwWindowShouldClose(renderer->mWindow)) {
+        CPU_PROFILE_ZONE("Frame");
+        if (!headless) {
+            glfwPollEvents();
+        }
 
         auto time = std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::system_clock::now().time_since_epoch()).count() / 1000000000.0;
         // The delta time in seconds.
         float deltaTime = time - lastLoopTime;
         lastLoopTime = time;
 
-        // Display the FPS on the title.
-        glfwSetWindowTitle(renderer->mWindow, ("Vulkan Test | FPS: " + std::to_string(1 / deltaTime)).c_str());
-
-        // If the left key is press, rotate the object left.
-        int leftKeyState = glfwGetKey(renderer->mWindow, GLFW_KEY_LEFT);
-        if (leftKeyState == GLFW_PRESS) {
-            //modelMatrix = glm::rotate(modelMatrix, deltaTime * glm::radians(90.0f), glm::vec3(0.0f, -1.0f, 0.0f));
-            camera.MoveLeft(5 * deltaTime);
-        }
-
-        // If the right key is pressed, rotate the object right.
-        int rightKeyState = glfwGetKey(renderer->mWindow, GLFW_KEY_RIGHT);
-        if (rightKeyState == GLFW_PRESS) {
-           //modelMatrix = glm::rotate(modelMatrix, deltaTime * glm::radians(90.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-            camera.MoveRight(5 * deltaTime);
-        }
-
-        if (glfwGetKey(renderer->mWindow, GLFW_KEY_UP) == GLFW_PRESS) {
-            camera.MoveForward(5 * deltaTime);
+        if (!headless) {
+            ProcessInput(deltaTime);
         }
 
-        if (glfwGetKey(renderer->mWindow, GLFW_KEY_DOWN) == GLFW_PRESS) {
-            camera.MoveBackward(5 * deltaTime);
-        }
-
-        // If the right key is pressed, rotate the object right.
-        int shiftKeyState = glfwGetKey(renderer->mWindow, GLFW_KEY_LEFT_SHIFT);
-        if (shiftKeyState == GLFW_PRESS) {
-            modelMatrix = glm::translate(modelMatrix, glm::vec3(0, -1 * deltaTime, 0));
-        }
+        UpdateChunkLods();
+        EnforceMemoryBudget();
+        QueueDirtyChunks();
 
         auto currentImage = renderer->StartFrameDrawing();
+        // Uniforms and descriptor sets are per frame in flight, the framebuffer is per swap chain image.
+        auto currentFrame = renderer->SwapChain()->CurrentFrame();
 
-        UpdateUniformBuffer(currentImage);
+        UpdateUniformBuffer(currentFrame);
 
         // Record Commands
+        // Already reset along with the rest of the frame's command pool.
         auto frameCommandBuffer = renderer->GetFrameCommandBuffer();
-        frameCommandBuffer->Reset();
         frameCommandBuffer->StartCommandRecording();
-        frameCommandBuffer->StartRenderPass(renderer->RenderPass(), renderer->SwapChain()->FrameBuffers()[currentImage], renderer->SwapChain()->Extent(), {164 / 255.0, 236 / 255.0, 252 / 255.0, 1.0});
-        frameCommandBuffer->BindPipeline(renderer->PrimaryGraphicsPipeline()->Pipeline());
-        frameCommandBuffer->SetViewportScissor(renderer->SwapChain()->Extent());
-
+        if (renderer->GpuProfiler() != nullptr)
+        {
+            renderer->GpuProfiler()->BeginFrame(frameCommandBuffer, currentFrame);
+        }
+        // Load every mesh once, a remesh may publish a new one while recording.
+        chunkDraws.clear();
         int finishedCount = 0;
-
-        for (auto& chunk : chunks)
         {
-            if (chunk->FinishedGenerating() && chunk->IndiciesSize() > 0)
+            CPU_PROFILE_ZONE("CollectDraws");
+            for (auto& chunk : chunks)
             {
-                frameCommandBuffer->BindVertexBuffer(chunk->VertexBuffer());
-                frameCommandBuffer->BindIndexBuffer(chunk->IndexBuffer());
-                frameCommandBuffer->BindVertexBuffer(chunk->ModelBuffer(), 0, 1); // Bind matrix buffer.
-                frameCommandBuffer->BindDescriptorSet(renderer->PrimaryGraphicsPipeline()->PipelineLayout(), renderer->DescriptorHandler()->DescriptorSetBuilder()->GetBuiltDescriptorSets()[currentImage]);
-                frameCommandBuffer->DrawIndexed(chunk->IndiciesSize());
+                auto mesh = chunk->Mesh();
+                if (mesh != nullptr && mesh->IndexCount != 0)
+                {
+                    if (!CHUNK_PUSH_CONSTANT_TRANSFORMS)
+                    {
+                        // Here rather than while recording, model matrices are only written on the render thread.
+                        // Only written if the chunk's model buffer is new or the root transform changed.
+                        // The mesh was loaded after the model buffer was created, so it is always written before the first draw.
+                        chunk->UpdateModelMatrix(modelMatrix, modelMatrixVersion);
+                    }
+                    chunkDraws.push_back({ chunk, mesh });
+                }
+
+                if (chunk->FinishedGenerating())
+                {
+                    finishedCount++;
+                }
             }
+        }
 
-            if (chunk->FinishedGenerating())
+        VkClearColorValue skyColor = { 164 / 255.0, 236 / 255.0, 252 / 255.0, 1.0 };
+        VkFramebuffer frameBuffer = renderer->SwapChain()->FrameBuffers()[currentImage];
+        {
+            // Begun outside the render pass, timestamps can't be written between secondary command buffers.
+            VulkanGpuScope mainPassScope(renderer->GpuProfiler(), frameCommandBuffer, "MainPass");
+            if (renderer->ParallelRecorder() != nullptr)
             {
-                finishedCount++;
+                frameCommandBuffer->StartRenderPass(renderer->RenderPass(), frameBuffer, renderer->SwapChain()->Extent(), skyColor, { 1.0f, 0 }, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                // Nothing is recorded if neither the visible meshes nor the extent or pipeline changed since this frame was last recorded.
+                auto secondaryBuffers = renderer->ParallelRecorder()->Record(currentFrame, renderer->RenderPass(), frameBuffer, chunkDraws.size(),
+                    [currentFrame](auto commandBuffer, size_t begin, size_t end) {
+                        RecordChunkDraws(commandBuffer, currentFrame, begin, end);
+                    }, &ChunkDrawsKey());
+                frameCommandBuffer->ExecuteCommands(secondaryBuffers);
+            }
+            else
+            {
+                frameCommandBuffer->StartRenderPass(renderer->RenderPass(), frameBuffer, renderer->SwapChain()->Extent(), skyColor);
+                RecordChunkDraws(frameCommandBuffer, currentFrame, 0, chunkDraws.size());
             }
-        }
 
-        frameCommandBuffer->EndRenderPass();
+            frameCommandBuffer->EndRenderPass();
+        }
         frameCommandBuffer->EndCommandRecording();
-
+        lastFrameStatistics = frameCommandBuffer->Statistics();
+        if (renderer->ParallelRecorder() != nullptr)
+        {
+            lastFrameStatistics.Issued += renderer->ParallelRecorder()->Statistics().Issued;
+            lastFrameStatistics.Elided += renderer->ParallelRecorder()->Statistics().Elided;
+        }
 
         renderer->EndFrameDrawing(currentImage);
 
@@ -357,13 +882,62 @@ int main() {
             auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(stopTime - startTime);
             std::cout << "Finished Loading Chunks In Time: " << duration.count() << " ms" << std::endl;
             finished = true;
+            timingStartTime = std::chrono::high_resolution_clock::now();
+        }
+        else if (finished)
+        {
+            timedFrames++;
+            if (renderer->ParallelRecorder() != nullptr && renderer->ParallelRecorder()->LastRecordReused())
+            {
+                reusedFrames++;
+            }
+            if (renderer->GpuProfiler() != nullptr && renderer->GpuProfiler()->ResolvedFrames() != lastResolvedGpuFrame)
+            {
+                lastResolvedGpuFrame = renderer->GpuProfiler()->ResolvedFrames();
+                gpuMainPassMilliseconds += renderer->GpuProfiler()->Milliseconds("MainPass");
+                gpuTimedFrames++;
+            }
+        }
+    }
+
+    if (headless && timedFrames > 0)
+    {
+        auto duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - timingStartTime);
+        std::cout << "Rendered " << timedFrames << " headless frames, average frame time: " << duration.count() / timedFrames << " ms" << std::endl;
+        std::cout << "Binds in the last frame: " << lastFrameStatistics.Issued << " issued, " << lastFrameStatistics.Elided << " elided" << std::endl;
+        std::cout << "Frames reusing recorded chunk draws: " << reusedFrames << std::endl;
+        if (gpuTimedFrames > 0)
+        {
+            std::cout << "Average GPU time of the main pass: " << gpuMainPassMilliseconds / gpuTimedFrames << " ms" << std::endl;
+        }
+
+        std::cout << VulkanMemoryStats::Report();
+        for (auto& heap : renderer->QueryMemoryBudget())
+        {
+            std::cout << (heap.DeviceLocal ? "Device local" : "Host") << " heap: " << heap.Usage / (1024 * 1024) << " / " << heap.Budget / (1024 * 1024)
+                << " MiB budget (" << heap.Size / (1024 * 1024) << " MiB heap" << (heap.Reported ? "" : ", estimated") << ")" << std::endl;
         }
     }
 
+    {
+        std::lock_guard<std::mutex> lock(remeshMutex);
+        remeshRunning = false;
+    }
+    remeshCondition.notify_all();
+    for (auto& remeshThread : remeshThreads)
+    {
+        remeshThread.join();
+    }
+
     vkDeviceWaitIdle(renderer->mDevice);
 
     CleanUpBuffers();
     renderer->cleanup();
 
+    if (!cpuTracePath.empty() && !CpuProfiler::WriteChromeTrace(cpuTracePath))
+    {
+        std::cout << "Failed to write the CPU trace to " << cpuTracePath << std::endl;
+    }
+
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,26 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+
+// The chunk's location in voxels. Chunks only ever translate, so the rest of the transform is ubo.model.
+layout(push_constant) uniform ChunkTransform {
+	vec3 origin;
+} chunk;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+void main() {
+    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition + chunk.origin, 1.0);
+    fragColor = inColor;
+	fragTexCoord = inTexCoord;
+}
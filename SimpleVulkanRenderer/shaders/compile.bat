@@ -1,3 +1,4 @@
 C:/VulkanSDK/1.3.250.0/Bin/glslc.exe shader.vert -o vert.spv
 C:/VulkanSDK/1.3.250.0/Bin/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.3.250.0/Bin/glslc.exe chunk_push.vert -o vert_push.spv
 pause
\ No newline at end of file